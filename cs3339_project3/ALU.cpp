@@ -23,7 +23,8 @@ uint32_t ALU::op(ALU_OP op, uint32_t src1, uint32_t src2) {
                  break;
     case DIV   : if(src2 == 0) {
                    cerr << "division by zero!" << endl;
-                   exit(-1);
+                   fault = FAULT_DIV_ZERO;
+                   break;
                  }
                  lower = src1 / src2;
                  upper = src1 % src2;
@@ -5,19 +5,24 @@
 #include <cstdint>
 #include <iomanip>
 #include <cstdlib>
+#include "Fault.h"
 #include "Debug.h"
 using namespace std;
 
-enum ALU_OP { ADD, AND, SHF_L, SHF_R, CMP_LT, MUL, DIV };
+enum ALU_OP { ADD, AND, SHF_L, SHF_R, CMP_LT, MUL, DIV, ALU_OPS };
 
 class ALU {
   private:
     uint32_t upper, lower;
+    FAULT fault;
 
   public:
+    ALU() : upper(0), lower(0), fault(FAULT_NONE) {}
+
     uint32_t op(ALU_OP op, uint32_t src1, uint32_t src2);
     uint32_t getUpper() const { return upper; }
     uint32_t getLower() const { return lower; }
+    FAULT getFault() const { return fault; }
 };
 
 #endif
@@ -0,0 +1,133 @@
+/*
+ * Batch runner: many independent simulations in one process.
+ */
+
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include "Batch.h"
+#include "WorkPool.h"
+#include "CPU.h"
+#include "Memory.h"
+
+bool Batch::load(const char *manifest) {
+  ifstream f(manifest);
+  if(!f) {
+    cerr << "Could not open " << manifest << endl;
+    return false;
+  }
+
+  string line;
+  for(int lineNo = 1; getline(f, line); lineNo++) {
+    istringstream fields(line);
+    string word;
+    Job j;
+
+    if(!(fields >> j.binary) || j.binary[0] == '#') continue;
+    if(!(fields >> j.inputFile)) {
+      cerr << manifest << ":" << lineNo << ": missing input file" << endl;
+      return false;
+    }
+    while(fields >> word) {
+      if(word != "--fu" || !(fields >> word) || !parseFUSpec(word.c_str(), j.fu)) {
+        cerr << manifest << ":" << lineNo << ": bad option " << word << endl;
+        return false;
+      }
+    }
+
+    if(j.inputFile != "-") {
+      ifstream in(j.inputFile.c_str());
+      if(!in) {
+        cerr << manifest << ":" << lineNo << ": could not open " << j.inputFile << endl;
+        return false;
+      }
+      ostringstream text;
+      text << in.rdbuf();
+      j.input = text.str();
+    }
+
+    if(!images.count(j.binary) && !images[j.binary].load(j.binary.c_str()))
+      return false;
+    jobs.push_back(j);
+  }
+
+  // map nodes do not move, so the pointers stay valid
+  for(size_t i = 0; i < jobs.size(); i++)
+    jobs[i].prog = &images[jobs[i].binary];
+  if(jobs.empty()) {
+    cerr << manifest << ": no jobs" << endl;
+    return false;
+  }
+  return true;
+}
+
+void Batch::runJob(Job &j) {
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  Memory instMem(j.prog->instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  PipelineCPU cpu(j.prog->start, instMem, dataMem);
+  Stats stats;
+  istringstream in(j.input);
+  ostringstream out;
+
+  stats.setFU(j.fu);
+  cpu.setStats(stats);
+  j.prog->initInstMem(instMem);
+  cpu.setIO(in, out);
+  j.fault = cpu.run();
+
+  j.instructions = cpu.getInstructions();
+  j.cycles = stats.getCycles();
+  j.bubbles = stats.getBubbles();
+  j.flushes = stats.getFlushes();
+  j.outputBytes = out.str().size();
+  chrono::duration<double> host = chrono::steady_clock::now() - t0;
+  j.host = host.count();
+}
+
+void Batch::run() {
+  WorkPool pool(threads);
+
+  // hand out the jobs; their sizes are unknown, stealing evens things out
+  for(size_t i = 0; i < jobs.size(); i++) {
+    Job *j = &jobs[i];
+    pool.add([this, j] { runJob(*j); });
+  }
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  pool.run();
+  chrono::duration<double> wall = chrono::steady_clock::now() - t0;
+
+  report(wall.count(), pool.getSteals());
+}
+
+void Batch::report(double wall, long long steals) {
+  long long insts = 0;
+  double busy = 0.0;
+  int failed = 0;
+
+  cout << "Batch: " << jobs.size() << " jobs, " << images.size() << " distinct binaries, "
+       << threads << " worker thread" << (threads > 1 ? "s" : "") << endl;
+  cout << "  " << setw(3) << "#" << "  " << setw(16) << left << "binary" << setw(12) << "input" << right
+       << setw(12) << "insts" << setw(12) << "cycles" << setw(7) << "CPI" << setw(11) << "bubbles"
+       << setw(11) << "flushes" << setw(9) << "output" << setw(9) << "host s" << endl;
+  for(size_t i = 0; i < jobs.size(); i++) {
+    const Job &j = jobs[i];
+    cout << "  " << setw(3) << i + 1 << "  " << setw(16) << left << j.binary << setw(12) << j.inputFile << right
+         << setw(12) << j.instructions << setw(12) << j.cycles << setw(7) << fixed << setprecision(2)
+         << (j.instructions ? (double)j.cycles / j.instructions : 0.0) << setw(11) << j.bubbles
+         << setw(11) << j.flushes << setw(9) << j.outputBytes << setw(9) << setprecision(3) << j.host;
+    if(j.fault != FAULT_NONE) {
+      cout << "  stopped: " << faultName(j.fault);
+      failed++;
+    }
+    cout << endl;
+    insts += j.instructions;
+    busy += j.host;
+  }
+  cout << "  " << insts << " instructions in " << setprecision(2) << wall << " s wall time ("
+       << busy << " s of job time, " << steals << " jobs stolen, "
+       << setprecision(1) << (wall > 0 ? insts / wall / 1e6 : 0.0) << " MIPS)" << endl;
+  if(failed)
+    cout << "  " << failed << " job" << (failed > 1 ? "s" : "") << " stopped on a guest fault" << endl;
+}
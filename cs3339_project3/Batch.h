@@ -0,0 +1,50 @@
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include "Program.h"
+#include "Stats.h"
+#include "Fault.h"
+#include "Debug.h"
+using namespace std;
+
+// Runs a manifest of simulation jobs on a WorkPool in one process.  Each
+// manifest line is
+//   binary.mips  input-file  [--fu OP:LAT[:np]]...
+// where input-file holds the trap input ("-" for none).  Every distinct
+// binary is loaded once and its image shared read-only by all its jobs;
+// each job gets its own memories, CPU and Stats.  Guest output is kept
+// per job and only its size is reported.
+class Batch {
+  public:
+    Batch(int threads) : threads(threads) {}
+
+    bool load(const char *manifest);
+    void run();
+
+  private:
+    struct Job {
+      string binary, inputFile, input;
+      FUConfig fu;
+      const Program *prog;
+
+      // results
+      FAULT fault;
+      long long instructions, cycles, bubbles, flushes;
+      size_t outputBytes;
+      double host;
+    };
+
+    int threads;
+    map<string, Program> images;
+    vector<Job> jobs;
+
+    void runJob(Job &j);
+    void report(double wall, long long steals);
+};
+
+#endif
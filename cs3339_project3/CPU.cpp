@@ -9,6 +9,13 @@
 #include "CPU.h"
 #include "Stats.h"
 
+// disassembly: always in a DEBUG build, otherwise when the trace policy asks
+#ifdef DEBUG
+#define TR(x) x
+#else
+#define TR(x) if(Trace::DISASM) { x; }
+#endif
+
 
 /*
  * Initializes a MIPS CPU simulator with predefined register names and values.
@@ -17,12 +24,13 @@
  * MIPS instruction execution, tracking the instruction count and a stop flag.
  */
 
-const string CPU::regNames[] = {"$zero","$at","$v0","$v1","$a0","$a1","$a2","$a3",
-                                "$t0","$t1","$t2","$t3","$t4","$t5","$t6","$t7",
-                                "$s0","$s1","$s2","$s3","$s4","$s5","$s6","$s7",
-                                "$t8","$t9","$k0","$k1","$gp","$sp","$fp","$ra"};
+static const string regNames[] = {"$zero","$at","$v0","$v1","$a0","$a1","$a2","$a3",
+                                   "$t0","$t1","$t2","$t3","$t4","$t5","$t6","$t7",
+                                   "$s0","$s1","$s2","$s3","$s4","$s5","$s6","$s7",
+                                   "$t8","$t9","$k0","$k1","$gp","$sp","$fp","$ra"};
 
-CPU::CPU(uint32_t pc, Memory &iMem, Memory &dMem) : pc(pc), iMem(iMem), dMem(dMem) {
+template<class Timing, class Mem, class Trace>
+BasicCPU<Timing, Mem, Trace>::BasicCPU(uint32_t pc, Memory &iMem, Memory &dMem) : pc(pc), iMem(iMem), dMem(dMem) {
   for(int i = 0; i < NREGS; i++) {
     regFile[i] = 0;
   }
@@ -33,6 +41,12 @@ CPU::CPU(uint32_t pc, Memory &iMem, Memory &dMem) : pc(pc), iMem(iMem), dMem(dMe
 
   instructions = 0;
   stop = false;
+  fault = FAULT_NONE;
+  coreId = 0;
+  numCores = 1;
+  syncYield = syncPending = syncGranted = false;
+  in = &cin;
+  out = &cout;
 }
 /*
  * The `run` method continuously executes the CPU simulation cycle until a stop condition is met,
@@ -45,26 +59,74 @@ CPU::CPU(uint32_t pc, Memory &iMem, Memory &dMem) : pc(pc), iMem(iMem), dMem(dMe
  * setting up control signals for execution but initially setting all to false or a default state.
  */
 
-void CPU::run() {
-  while(!stop) {
+template<class Timing, class Mem, class Trace>
+FAULT BasicCPU<Timing, Mem, Trace>::run(long long limit) {
+  while(!stop && (limit == 0 || instructions < limit)) {
     instructions++;
 
     fetch();
-    decode();
-    execute();
-    mem();
+    if(Mem::SHARED && syncYield && fault == FAULT_NONE && (instr >> 26) == 0x38) {
+      // sc: leave it for the host to run at the next sync point
+      if(!syncGranted) {
+        pc -= 4;
+        instructions--;
+        syncPending = true;
+        break;
+      }
+      syncGranted = false;
+    }
+    if(fault == FAULT_NONE) decode();
+    if(fault == FAULT_NONE) execute();
+    if(fault == FAULT_NONE) mem();
+    if(fault != FAULT_NONE) {
+      // the faulting instruction does not complete
+      stop = true;
+      break;
+    }
     writeback();
 
-    D(printRegFile());
+    if(RECORDS && !trace.consume(rec))
+      timing.process(rec);
+
+    trace.step(*this);
+    D(if(!Trace::DISASM) printRegFile());   // unless DisasmTrace::step just did
   }
+  return fault;
+}
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::getState(CPUState &s) const {
+  s.pc = pc;
+  for(int i = 0; i < NREGS; i++)
+    s.regs[i] = regFile[i];
+  s.hi = hi;
+  s.lo = lo;
+  s.instructions = instructions;
+}
+
+// resumes from s; the memories and trap input are the caller's business
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::setState(const CPUState &s) {
+  pc = s.pc;
+  for(int i = 0; i < NREGS; i++)
+    regFile[i] = s.regs[i];
+  hi = s.hi;
+  lo = s.lo;
+  instructions = s.instructions;
+  stop = false;
+  fault = FAULT_NONE;
 }
+
 //prepare to fetch the next instruction
-void CPU::fetch() {
-  instr = iMem.loadWord(pc);
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::fetch() {
+  instr = iMem.load(pc);
+  fault = iMem.fault();
+  if(RECORDS) rec.clear(pc);
   pc = pc + 4;
 }
 
-void CPU::decode() {
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::decode() {
   uint32_t opcode;      // opcode field
   uint32_t rs, rt, rd;  // register specifiers
   uint32_t shamt;       // shift amount (R-type)
@@ -87,6 +149,9 @@ void CPU::decode() {
   opIsLoad = false;
   opIsStore = false;
   opIsMultDiv = false;
+  opIsLL = false;
+  opIsSC = false;
+  opUsesUnit = true;
   aluOp = ADD;
   storeData = 0;
 
@@ -102,201 +167,243 @@ void CPU::decode() {
  * instructions like jump register (jr). If an instruction is not supported, an error message is triggered.
  */
 
-  D(cout << "  " << hex << setw(8) << pc - 4 << ": ");
+  TR(cout << "  " << hex << setw(8) << pc - 4 << ": ");
   switch(opcode) {
     case 0x00:
       switch(funct) {
         //The operation being performed here is a logical left shift (sll).
-        case 0x00: D(cout << "sll " << regNames[rd] << ", " << regNames[rs] << ", " << dec << shamt);
+        case 0x00: TR(cout << "sll " << regNames[rd] << ", " << regNames[rs] << ", " << dec << shamt);
         // Indicates that the result of the operation should be written back to a destination register.
               writeDest = true;
               // Specifies the destination register where the result will be stored.
               destReg = rd;
-              stats.registerDest(rd);
+              recDest(rd);
               //Sets the ALU operation to perform a logical left shift.
               aluOp = SHF_L;
               // Specifies the first operand for the ALU operation as the value stored in the source register rs
               aluSrc1 = regFile[rs];
               //Registers rs as one of the source registers for statistical tracking.
-              stats.registerSrc(rs);
+              recSrc(rs);
               //Specifies the second operand for the ALU operation as the shift amount shamt.
               aluSrc2 = shamt;
              break; 
-        case 0x03: D(cout << "sra " << regNames[rd] << ", " << regNames[rs] << ", " << dec << shamt);
+        case 0x03: TR(cout << "sra " << regNames[rd] << ", " << regNames[rs] << ", " << dec << shamt);
 
               writeDest = true; destReg = rd;
-              stats.registerDest(rd);
+              recDest(rd);
               aluOp = SHF_R;
               aluSrc1 = regFile[rs];
-              stats.registerSrc(rs);
+              recSrc(rs);
               aluSrc2 = shamt;
              break; 
-        case 0x08: D(cout << "jr " << regNames[rs]);
+        case 0x08: TR(cout << "jr " << regNames[rs]);
+              opUsesUnit = false;
               pc = regFile[rs];
-              stats.flush(2);
+              recFlag(REC_JR);
              break;
-        case 0x10: D(cout << "mfhi " << regNames[rd]);
+        case 0x10: TR(cout << "mfhi " << regNames[rd]);
               writeDest = true;
               destReg = rd;
-              stats.registerDest(rd);
+              recDest(rd);
               aluOp = ADD;
               aluSrc1 = hi;
-              stats.registerSrc(REG_HILO);
+              recSrc(REG_HILO);
               aluSrc2 = regFile[REG_ZERO];
              break;
-        case 0x12: D(cout << "mflo " << regNames[rd]);
+        case 0x12: TR(cout << "mflo " << regNames[rd]);
               writeDest = true;
               destReg = rd;
-              stats.registerDest(rd);
+              recDest(rd);
               aluOp = ADD;
               aluSrc1 = lo;
-              stats.registerSrc(REG_HILO);
+              recSrc(REG_HILO);
               aluSrc2 = regFile[REG_ZERO];
              break;
-        case 0x18: D(cout << "mult " << regNames[rs] << ", " << regNames[rt]);
+        case 0x18: TR(cout << "mult " << regNames[rs] << ", " << regNames[rt]);
               opIsMultDiv = true;
-              stats.registerDest(REG_HILO);
+              recDest(REG_HILO);
               aluOp = MUL;
               aluSrc1 = regFile[rs];
-              stats.registerSrc(rs);
+              recSrc(rs);
               aluSrc2 = regFile[rt];
-              stats.registerSrc(rt);
+              recSrc(rt);
              break;
-        case 0x1a: D(cout << "div " << regNames[rs] << ", " << regNames[rt]);
+        case 0x1a: TR(cout << "div " << regNames[rs] << ", " << regNames[rt]);
               opIsMultDiv = true;
-              stats.registerDest(REG_HILO);
+              recDest(REG_HILO);
               aluOp = DIV;
               aluSrc1 = regFile[rs];
-              stats.registerSrc(rs);
+              recSrc(rs);
               aluSrc2 = regFile[rt];
-              stats.registerSrc(rt);
+              recSrc(rt);
               break;
-        case 0x21: D(cout << "addu " << regNames[rd] << ", " << regNames[rs] << ", " << regNames[rt]);
+        case 0x21: TR(cout << "addu " << regNames[rd] << ", " << regNames[rs] << ", " << regNames[rt]);
               writeDest = true;
               destReg = rd;
-              stats.registerDest(rd);
+              recDest(rd);
               aluOp = ADD;
               aluSrc1 = regFile[rs];
-              stats.registerSrc(rs);
+              recSrc(rs);
               aluSrc2 = regFile[rt];
-              stats.registerSrc(rt);
+              recSrc(rt);
              break;
-        case 0x23: D(cout << "subu " << regNames[rd] << ", " << regNames[rs] << ", " << regNames[rt]);
+        case 0x23: TR(cout << "subu " << regNames[rd] << ", " << regNames[rs] << ", " << regNames[rt]);
               writeDest = true;
               destReg = rd;
-              stats.registerDest(rd);
+              recDest(rd);
               aluOp = ADD;
               aluSrc1 = regFile[rs];
-              stats.registerSrc(rs);
+              recSrc(rs);
               aluSrc2 = -regFile[rt];
-              stats.registerSrc(rt);
+              recSrc(rt);
              break; //hint: subtract is the same as adding a negative
-        case 0x2a: D(cout << "slt " << regNames[rd] << ", " << regNames[rs] << ", " << regNames[rt]);
+        case 0x2a: TR(cout << "slt " << regNames[rd] << ", " << regNames[rs] << ", " << regNames[rt]);
               writeDest = true;
               destReg = rd;
+              recDest(rd);
               aluOp = CMP_LT;
               aluSrc1 = regFile[rs];
-              stats.registerSrc(rs);
+              recSrc(rs);
               aluSrc2 = regFile[rt];
-              stats.registerSrc(rt);
+              recSrc(rt);
              break;
-        default: cerr << "unimplemented instruction: pc = 0x" << hex << pc - 4 << endl;
+        default: cerr << "unimplemented instruction: pc = 0x" << hex << pc - 4 << dec << endl;
       }
       break;
-    case 0x02: D(cout << "j " << hex << ((pc & 0xf0000000) | addr << 2)); // P1: pc + 4
+    case 0x02: TR(cout << "j " << hex << ((pc & 0xf0000000) | addr << 2)); // P1: pc + 4
+             opUsesUnit = false;
              writeDest = false;
              pc = (pc & 0xf0000000) | addr << 2;
-             stats.flush(2);
+             recFlag(REC_JUMP);
              break;
-    case 0x03: D(cout << "jal " << hex << ((pc & 0xf0000000) | addr << 2)); // P1: pc + 4
+    case 0x03: TR(cout << "jal " << hex << ((pc & 0xf0000000) | addr << 2)); // P1: pc + 4
+          opUsesUnit = false;
           writeDest = true;
           destReg = REG_RA;
-          stats.registerDest(REG_RA);
+          recDest(REG_RA);
           aluOp = ADD;
           aluSrc1 = pc;
           aluSrc2 = regFile[REG_ZERO];
           pc = (pc & 0xf0000000) | addr << 2;
-          stats.flush(2);
+          recFlag(REC_JUMP);
                break;
-    case 0x04: D(cout << "beq " << regNames[rs] << ", " << regNames[rt] << ", " << pc + (simm << 2));
-               stats.countBranch();
-               stats.registerSrc(rs);
-               stats.registerSrc(rt);
-               if (regFile[rs] == regFile[rt])
-               pc = pc + (simm << 2);
-               stats.countTaken();
-               stats.flush(2);
+    case 0x04: TR(cout << "beq " << regNames[rs] << ", " << regNames[rt] << ", " << pc + (simm << 2));
+               opUsesUnit = false;
+               recFlag(REC_BRANCH);
+               recSrc(rs);
+               recSrc(rt);
+               if (regFile[rs] == regFile[rt]) {
+                 pc = pc + (simm << 2);
+                 recFlag(REC_TAKEN);
+               }
           break;  // read the handout carefully, update PC directly here as in jal example
-    case 0x05: D(cout << "bne " << regNames[rs] << ", " << regNames[rt] << ", " << pc + (simm << 2));
-               istats.countBranch();
-               stats.registerSrc(rs);
-               stats.registerSrc(rt);
-               if (regFile[rs] != regFile[rt])
-               pc = pc + (simm << 2);
-               stats.countTaken();
-               stats.flush(2);
+    case 0x05: TR(cout << "bne " << regNames[rs] << ", " << regNames[rt] << ", " << pc + (simm << 2));
+               opUsesUnit = false;
+               recFlag(REC_BRANCH);
+               recSrc(rs);
+               recSrc(rt);
+               if (regFile[rs] != regFile[rt]) {
+                 pc = pc + (simm << 2);
+                 recFlag(REC_TAKEN);
+               }
                break;  // same comment as beq
-    case 0x09: D(cout << "addiu " << regNames[rt] << ", " << regNames[rs] << ", " << dec << simm);
+    case 0x09: TR(cout << "addiu " << regNames[rt] << ", " << regNames[rs] << ", " << dec << simm);
                writeDest = true;
                destReg = rt;
-               stats.registerDest(rt);
+               recDest(rt);
                aluOp = ADD;
                aluSrc1 = regFile[rs];
-               stats.registerSrc(rs);
+               recSrc(rs);
                aluSrc2 = simm;
                break;
-    case 0x0c: D(cout << "andi " << regNames[rt] << ", " << regNames[rs] << ", " << dec << uimm);
+    case 0x0c: TR(cout << "andi " << regNames[rt] << ", " << regNames[rs] << ", " << dec << uimm);
                writeDest = true;
                destReg = rt;
-               stats.registerDest(rt);
+               recDest(rt);
                aluOp = AND;
                aluSrc1 = regFile[rs];
-               stats.registerSrc(rs);
+               recSrc(rs);
                aluSrc2 = uimm;
                break;
-    case 0x0f: D(cout << "lui " << regNames[rt] << ", " << dec << simm);
+    case 0x0f: TR(cout << "lui " << regNames[rt] << ", " << dec << simm);
                writeDest = true;
-               stats.registerDest(rt);
+               destReg = rt;
+               recDest(rt);
                aluOp = SHF_L;
                aluSrc1 = simm;
                aluSrc2 = 16;
                break; //use the ALU to execute necessary op, you may set aluSrc2 = xx directly
-    case 0x1a: D(cout << "trap " << hex << addr);
+    case 0x1a: TR(cout << "trap " << hex << addr);
+               opUsesUnit = false;
                switch(addr & 0xf) {
-                 case 0x0: cout << endl; break;
-                 case 0x1: cout << " " << (signed)regFile[rs];
+                 case 0x0: *out << endl; break;
+                 case 0x1: *out << " " << (signed)regFile[rs];
+                           recSrc(rs);
                            break;
-                 case 0x5: cout << endl << "? "; cin >> regFile[rt];
+                 case 0x5: *out << endl << "? "; *in >> regFile[rt];
+                           recDest(rt);
+                           break;
+                 case 0x6: regFile[rt] = coreId;
+                           recDest(rt);
+                           break;
+                 case 0x7: regFile[rt] = numCores;
+                           recDest(rt);
                            break;
                  case 0xa: stop = true; break;
-                 default: cerr << "unimplemented trap: pc = 0x" << hex << pc - 4 << endl;
+                 default: cerr << "unimplemented trap: pc = 0x" << hex << pc - 4 << dec << endl;
                           stop = true;
                }
                break;
-    case 0x23: D(cout << "lw " << regNames[rt] << ", " << dec << simm << "(" << regNames[rs] << ")");
+    case 0x23: TR(cout << "lw " << regNames[rt] << ", " << dec << simm << "(" << regNames[rs] << ")");
                  opIsLoad = true;
-                 stats.countMemOp();
+                 recFlag(REC_LOAD);
                  writeDest = true;
                  destReg = rt;
-                 stats.registerDest(rt);
+                 recDest(rt);
                  aluOp = ADD;
                  aluSrc1 = regFile[rs];
-                 stats.registerSrc(rs);
+                 recSrc(rs);
                  aluSrc2 = simm;
                break;  // do not interact with memory here - setup control signals for mem()
-    case 0x2b: D(cout << "sw " << regNames[rt] << ", " << dec << simm << "(" << regNames[rs] << ")");
+    case 0x30: TR(cout << "ll " << regNames[rt] << ", " << dec << simm << "(" << regNames[rs] << ")");
+                 opIsLoad = true;
+                 opIsLL = true;
+                 recFlag(REC_LOAD);
+                 writeDest = true;
+                 destReg = rt;
+                 recDest(rt);
+                 aluOp = ADD;
+                 aluSrc1 = regFile[rs];
+                 recSrc(rs);
+                 aluSrc2 = simm;
+               break;
+    case 0x38: TR(cout << "sc " << regNames[rt] << ", " << dec << simm << "(" << regNames[rs] << ")");
                  opIsStore = true;
-                 stats.countMemOp();
+                 opIsSC = true;
+                 recFlag(REC_STORE);
                  storeData = regFile[rt];
-                 stats.registerSrc(rt);
+                 writeDest = true;     // rt = 1 on success, 0 on failure
+                 destReg = rt;
+                 recSrc(rt);
+                 recDest(rt);
                  aluOp = ADD;
                  aluSrc1 = regFile[rs];
-                 stats.registerSrc(rs);
+                 recSrc(rs);
+                 aluSrc2 = simm;
+               break;
+    case 0x2b: TR(cout << "sw " << regNames[rt] << ", " << dec << simm << "(" << regNames[rs] << ")");
+                 opIsStore = true;
+                 recFlag(REC_STORE);
+                 storeData = regFile[rt];
+                 recSrc(rt);
+                 aluOp = ADD;
+                 aluSrc1 = regFile[rs];
+                 recSrc(rs);
                  aluSrc2 = simm;
                break;  // same comment as lw
-    default: cerr << "unimplemented instruction: pc = 0x" << hex << pc - 4 << endl;
+    default: cerr << "unimplemented instruction: pc = 0x" << hex << pc - 4 << dec << endl;
   }
-  D(cout << endl);
+  TR(cout << endl);
 }
 
 /*
@@ -307,21 +414,36 @@ void CPU::decode() {
  */
 
 
-void CPU::execute() {
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::execute() {
+  if(RECORDS) rec.aluOp = opUsesUnit ? aluOp : ALU_OPS;
   aluOut = alu.op(aluOp, aluSrc1, aluSrc2);
+  fault = alu.getFault();
 }
 
-void CPU::mem() {
-  if(opIsLoad)
-    writeData = dMem.loadWord(aluOut);
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::mem() {
+  if(RECORDS && (opIsLoad || opIsStore))
+    rec.memAddr = aluOut;
+
+  if(opIsLL)
+    writeData = dMem.loadLinked(aluOut);
+  else if(opIsLoad)
+    writeData = dMem.load(aluOut);
+  else if(opIsSC)
+    writeData = dMem.storeConditional(storeData, aluOut) ? 1 : 0;
   else
     writeData = aluOut;
 
-  if(opIsStore)
-    dMem.storeWord(storeData, aluOut);
+  if(opIsStore && !opIsSC)
+    dMem.store(storeData, aluOut);
+
+  if(opIsLoad || opIsStore)
+    fault = dMem.fault();
 }
 
-void CPU::writeback() {
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::writeback() {
   if(writeDest && destReg > 0) // skip when write is to zero_register
     regFile[destReg] = writeData;
   
@@ -331,7 +453,8 @@ void CPU::writeback() {
   }
 }
 
-void CPU::printRegFile() {
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::printRegFile() {
   cout << hex;
   for(int i = 0; i < NREGS; i++) {
     cout << "    " << regNames[i];
@@ -345,17 +468,24 @@ void CPU::printRegFile() {
   cout << dec << endl;
 }
 
-void CPU::printFinalStats() {
+template<class Timing, class Mem, class Trace>
+void BasicCPU<Timing, Mem, Trace>::printFinalStats(ostream &out) {
 
-  cout << "Program finished at pc = 0x" << hex << pc << "  (" << dec << instructions << " instructions executed)" << endl;
-  cout << "Cycles: " << stats.getCycles() << endl;
-  cout << "CPI: " << fixed << setprecision(2) << (float)stats.getCycles() / instructions << endl;
-  cout << "Bubbles: " << stats.getBubbles() << endl;
-  cout << "Flushes: " << stats.getFlushes() << endl;
-  cout << "Mem ops: " << setprecision(1) << 100.0 * stats.getMemOps() / instructions << "% of instructions" << endl;
-  cout << "Branches: " << 100.0 * stats.getBranches() / instructions << "% of instructions" << endl;
-  cout << "  % Taken: " << 100.0 * stats.getTaken() / stats.getBranches() << endl;
+  out << "Program finished at pc = 0x" << hex << pc << "  (" << dec << instructions << " instructions executed)" << endl;
+  timing.printStats(out, instructions);
 }
 
+void StatsTiming::printStats(ostream &out, long long instructions) {
+  RunSummary s;
 
+  stats->getSummary(s, instructions);
+  printRunSummary(s, out);
+  stats->printFUStats(out);
+}
 
+// the configurations named in CPU.h
+template class BasicCPU<StatsTiming, DynamicMemory, SinkTrace>;
+template class BasicCPU<NullTiming, DynamicMemory, NullTrace>;
+template class BasicCPU<NullTiming, FlatMemory, NullTrace>;
+template class BasicCPU<StatsTiming, FlatMemory, NullTrace>;
+template class BasicCPU<StatsTiming, FlatMemory, DisasmTrace>;
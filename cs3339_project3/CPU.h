@@ -8,18 +8,114 @@
 #include <cstdlib>
 #include "Memory.h"
 #include "ALU.h"
+#include "Trace.h"
+#include "Stats.h"
 #include "Debug.h"
 using namespace std;
 
-class CPU {
+// Architectural state of a CPU, for checkpoints
+struct CPUState {
+  uint32_t pc;
+  uint32_t regs[32];
+  uint32_t hi, lo;
+  long long instructions;
+};
+
+// Policies for BasicCPU.  Each kind has one small interface, so the core
+// compiles against any combination, and a null policy's calls are empty
+// inline functions.  RECORDS says whether a policy looks at the
+// per-instruction InstRecord; when neither timing nor trace does, the core
+// does not build one.
+
+// Timing: what the pipeline model makes of each completed instruction
+struct NullTiming {              // functional only
+  static const bool RECORDS = false;
+  void setStats(Stats &) {}
+  void process(const InstRecord &) {}
+  void printStats(ostream &, long long) {}
+};
+
+struct StatsTiming {             // the caller's Stats pipeline, see setStats
+  static const bool RECORDS = true;
+  Stats *stats;
+
+  StatsTiming() : stats(NULL) {}
+  void setStats(Stats &s) { stats = &s; }
+  void process(const InstRecord &rec) { stats->process(rec); }
+  void printStats(ostream &out, long long instructions);
+};
+
+// Memory: how loads and stores reach the memories
+struct DynamicMemory {           // any Memory subclass, through its virtual calls
+  static const bool SHARED = true;   // may be a core's view of shared memory (ll/sc, sync points)
+  Memory &m;
+
+  DynamicMemory(Memory &m) : m(m) {}
+  int size() const { return m.getSize(); }
+  FAULT fault() const { return m.getFault(); }
+  uint32_t load(uint32_t addr) { return m.loadWord(addr); }
+  void store(uint32_t data, uint32_t addr) { m.storeWord(data, addr); }
+  uint32_t loadLinked(uint32_t addr) { return m.loadLinked(addr); }
+  bool storeConditional(uint32_t data, uint32_t addr) { return m.storeConditional(data, addr); }
+};
+
+struct FlatMemory {              // a plain Memory owned by this CPU alone
+  static const bool SHARED = false;
+  Memory &m;
+
+  FlatMemory(Memory &m) : m(m) {}
+  int size() const { return m.getSize(); }
+  FAULT fault() const { return m.getFault(); }
+  uint32_t load(uint32_t addr) { return m.loadWordDirect(addr); }
+  void store(uint32_t data, uint32_t addr) { m.storeWordDirect(data, addr); }
+  uint32_t loadLinked(uint32_t addr) { return m.loadWordDirect(addr); }
+  bool storeConditional(uint32_t data, uint32_t addr) { m.storeWordDirect(data, addr); return true; }
+};
+
+// Trace: hooks around each instruction.  consume() returns true if it
+// took the record, in which case the timing policy does not see it.
+struct NullTrace {
+  static const bool RECORDS = false;
+  static const bool DISASM = false;
+  void setSink(TraceSink *) {}
+  bool consume(const InstRecord &) { return false; }
+  template<class C> void step(C &) {}
+};
+
+struct SinkTrace {               // an optional runtime TraceSink in place of the timing policy
+  static const bool RECORDS = true;
+  static const bool DISASM = false;
+  TraceSink *sink;
+
+  SinkTrace() : sink(NULL) {}
+  void setSink(TraceSink *s) { sink = s; }
+  bool consume(const InstRecord &rec) {
+    if(!sink) return false;
+    sink->consume(rec);
+    return true;
+  }
+  template<class C> void step(C &) {}
+};
+
+struct DisasmTrace {             // what a DEBUG build prints, without rebuilding
+  static const bool RECORDS = false;
+  static const bool DISASM = true;
+  void setSink(TraceSink *) {}
+  bool consume(const InstRecord &) { return false; }
+  template<class C> void step(C &cpu) { cpu.printRegFile(); }
+};
+
+template<class Timing, class Mem, class Trace>
+class BasicCPU {
   private:
     static const int NREGS = 32;
-    static const string regNames[];
 
     static const int REG_ZERO = 0;
     static const int REG_RA = 31;
     static const int REG_HILO = 32;
 
+    static const bool RECORDS = Timing::RECORDS || Trace::RECORDS;
+
     uint32_t pc;
     uint32_t instr;
 
@@ -29,14 +125,21 @@ class CPU {
 
     ALU alu;
     
-    Memory &iMem;
-    Memory &dMem;
+    Mem iMem;
+    Mem dMem;
 
-    int instructions;
+    long long instructions;
     bool stop;
+    FAULT fault;
+
+    // multicore: core number for traps 0x6/0x7, and whether sc has to
+    // wait at a sync point (syncPending) until the host grants it
+    int coreId, numCores;
+    bool syncYield, syncPending, syncGranted;
 
     // Control signals
-    bool opIsLoad, opIsStore, opIsMultDiv;
+    bool opIsLoad, opIsStore, opIsMultDiv, opIsLL, opIsSC;
+    bool opUsesUnit;      // false for control flow and traps, which occupy no execution unit
     ALU_OP aluOp;
     bool writeDest;
     int destReg;
@@ -47,11 +150,44 @@ class CPU {
     uint32_t aluOut;
     uint32_t writeData;
 
+    // Timing record for the current instruction; handed to the trace
+    // policy first, then to the timing policy
+    InstRecord rec;
+    Timing timing;
+    Trace trace;
+
+    // trap I/O
+    istream *in;
+    ostream *out;
+
   public:
-    CPU(uint32_t pc, Memory &iMem, Memory &dMem);
+    BasicCPU(uint32_t pc, Memory &iMem, Memory &dMem);
+
+    void setTraceSink(TraceSink *s) { trace.setSink(s); }
+    // with StatsTiming, required before run() unless a sink takes the records
+    void setStats(Stats &s) { timing.setStats(s); }
+    void setIO(istream &is, ostream &os) { in = &is; out = &os; }
+
+    long long getInstructions() const { return instructions; }
+    FAULT getFault() const { return fault; }
+    bool isStopped() const { return stop; }
 
-    void run();
-    void printFinalStats();
+    uint32_t getReg(int r) const { return regFile[r]; }
+    void setReg(int r, uint32_t v) { if(r > 0) regFile[r] = v; }
+
+    void getState(CPUState &s) const;
+    void setState(const CPUState &s);
+
+    void setCore(int id, int cores) { coreId = id; numCores = cores; }
+    void setSyncYield(bool y) { syncYield = y; }
+    bool isSyncPending() const { return syncPending; }
+    void grantSync() { syncPending = false; syncGranted = true; }
+
+    // limit: stop after this many instructions (0 = none); returns the
+    // guest fault that stopped the program, if any
+    FAULT run(long long limit = 0);
+    void printFinalStats(ostream &out = cout);
+    void printRegFile();
 
   private:
     void fetch();
@@ -59,8 +195,20 @@ class CPU {
     void execute();
     void mem();
     void writeback();
-    
-    void printRegFile();
+
+    void recSrc(int r) { if(RECORDS) rec.addSrc(r); }
+    void recDest(int r) { if(RECORDS) rec.setDest(r); }
+    void recFlag(int f) { if(RECORDS) rec.flags |= f; }
 };
 
+// The configurations instantiated in CPU.cpp.  CPU takes any Memory and
+// an optional sink and is what the sampling, multicore and checkpoint
+// models drive; DynamicFunctionalCPU also takes any Memory but builds no
+// records; the others fix everything at compile time.
+typedef BasicCPU<StatsTiming, DynamicMemory, SinkTrace> CPU;
+typedef BasicCPU<NullTiming, DynamicMemory, NullTrace> DynamicFunctionalCPU;
+typedef BasicCPU<NullTiming, FlatMemory, NullTrace> FunctionalCPU;
+typedef BasicCPU<StatsTiming, FlatMemory, NullTrace> PipelineCPU;
+typedef BasicCPU<StatsTiming, FlatMemory, DisasmTrace> TracedCPU;
+
 #endif
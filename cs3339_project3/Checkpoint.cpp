@@ -0,0 +1,215 @@
+/*
+ * Parallel detailed simulation of intervals restored from checkpoints.
+ */
+
+#include <chrono>
+#include <sstream>
+#include <cstring>
+#include "Checkpoint.h"
+#include "WorkPool.h"
+
+// zero-filled so untouched pages read the same in every copy
+CheckpointMemory::CheckpointMemory() : Memory(MEMSIZE, DATA_BASE, true), dirty(MEMSIZE / (PAGE_WORDS * 4), false) {
+  memset(mem, 0, numBytes);
+}
+
+void CheckpointMemory::storeWord(uint32_t data, uint32_t addr) {
+  int index = wordIndex(addr, true);
+  if(index < 0) return;
+  mem[index] = data;
+  dirty[index / PAGE_WORDS] = true;
+}
+
+void CheckpointMemory::savePage(int p, uint32_t *words) const {
+  memcpy(words, mem + p * PAGE_WORDS, PAGE_WORDS * sizeof(uint32_t));
+}
+
+void CheckpointMemory::loadPage(int p, const uint32_t *words) {
+  memcpy(mem + p * PAGE_WORDS, words, PAGE_WORDS * sizeof(uint32_t));
+}
+
+// oldest first
+void CheckpointSim::TailSink::copy(vector<InstRecord> &out) const {
+  long long first = n > (long long)ring.size() ? n - ring.size() : 0;
+  out.clear();
+  for(long long i = first; i < n; i++)
+    out.push_back(ring[i % ring.size()]);
+}
+
+CheckpointSim::CheckpointSim(const Program &prog, const Stats &base, const CheckpointConfig &cfg)
+    : prog(prog), base(base), cfg(cfg) {
+  instructions = 0;
+  endPc = 0;
+}
+
+// Most of the pass runs on a CPU that builds no records; only the last
+// warm instructions before each checkpoint run on one feeding the tail.
+FAULT CheckpointSim::functional(const string &input, ostream &out) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  CheckpointMemory dataMem;
+  DynamicFunctionalCPU cpu(prog.start, instMem, dataMem);
+  CPU tailCpu(prog.start, instMem, dataMem);
+  istringstream in(input);
+  TailSink tail(cfg.warm);
+  CPUState s;
+
+  prog.initInstMem(instMem);
+  cpu.setIO(in, out);
+  tailCpu.setIO(in, out);
+  tailCpu.setTraceSink(&tail);
+
+  for(;;) {
+    Checkpoint c;
+    cpu.getState(c.cpu);
+    streampos pos = in.tellg();
+    c.inPos = pos == streampos(-1) ? input.size() : (size_t)pos;
+    tail.copy(c.tail);
+    for(int p = 0; p < dataMem.pages(); p++) {
+      if(!dataMem.isDirty(p)) continue;
+      c.pageIds.push_back(p);
+      c.pages.resize(c.pages.size() + CheckpointMemory::PAGE_WORDS);
+      dataMem.savePage(p, &c.pages[c.pages.size() - CheckpointMemory::PAGE_WORDS]);
+    }
+    dataMem.clearDirty();
+    ckpts.push_back(c);
+
+    long long next = cpu.getInstructions() + cfg.interval;
+    if(next - cfg.warm > cpu.getInstructions() && cpu.run(next - cfg.warm) != FAULT_NONE)
+      return cpu.getFault();
+    cpu.getState(s);
+    if(cpu.isStopped()) break;
+
+    tailCpu.setState(s);
+    if(tailCpu.run(next) != FAULT_NONE)
+      return tailCpu.getFault();
+    tailCpu.getState(s);
+    if(tailCpu.isStopped()) break;
+    cpu.setState(s);
+  }
+
+  instructions = s.instructions;
+  endPc = s.pc;
+  return FAULT_NONE;
+}
+
+// times interval k: from checkpoint k up to the next one, or to the end
+void CheckpointSim::detailed(size_t k, const string &input) {
+  const Checkpoint &c = ckpts[k];
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  CheckpointMemory dataMem;
+  CPU cpu(prog.start, instMem, dataMem);
+  istringstream in(input);
+  ostringstream discard;
+  Stats timing(base);
+  StatsCounters before, after;
+
+  // newest copy of every page written up to checkpoint k
+  vector<bool> loaded(dataMem.pages(), false);
+  for(size_t i = k + 1; i-- > 0; ) {
+    const Checkpoint &src = ckpts[i];
+    for(size_t j = 0; j < src.pageIds.size(); j++) {
+      int p = src.pageIds[j];
+      if(loaded[p]) continue;
+      dataMem.loadPage(p, &src.pages[j * CheckpointMemory::PAGE_WORDS]);
+      loaded[p] = true;
+    }
+  }
+
+  prog.initInstMem(instMem);
+  cpu.setState(c.cpu);
+  in.seekg(c.inPos);
+  cpu.setIO(in, discard);
+  cpu.setStats(timing);
+
+  for(size_t i = 0; i < c.tail.size(); i++)
+    timing.process(c.tail[i]);
+  timing.getCounters(before);
+
+  long long end = k + 1 < ckpts.size() ? ckpts[k + 1].cpu.instructions : instructions;
+  cpu.run(end);
+  timing.getCounters(after);
+
+  StatsCounters &d = deltas[k];
+  d.cycles = after.cycles - before.cycles;
+  d.bubbles = after.bubbles - before.bubbles;
+  d.flushes = after.flushes - before.flushes;
+  d.memops = after.memops - before.memops;
+  d.branches = after.branches - before.branches;
+  d.taken = after.taken - before.taken;
+  for(int i = 0; i < STALL_CAUSES; i++)
+    d.stalls[i] = after.stalls[i] - before.stalls[i];
+  mismatched[k] = cpu.getInstructions() != end || cpu.getFault() != FAULT_NONE;
+}
+
+FAULT CheckpointSim::run(const string &input, ostream &out) {
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  FAULT fault = functional(input, out);
+  if(fault != FAULT_NONE)
+    return fault;
+  chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+  deltas.resize(ckpts.size());
+  mismatched.assign(ckpts.size(), false);
+  WorkPool pool(cfg.threads);
+  for(size_t k = 0; k < ckpts.size(); k++)
+    pool.add([this, k, &input] { detailed(k, input); });
+  pool.run();
+  chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+  chrono::duration<double> fast = t1 - t0, detail = t2 - t1;
+  if(!cfg.verify) {
+    report(fast.count(), detail.count(), NULL, 0.0);
+    return FAULT_NONE;
+  }
+
+  // one sequential detailed run for comparison
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  CheckpointMemory dataMem;
+  CPU cpu(prog.start, instMem, dataMem);
+  Stats full(base);
+  istringstream in(input);
+  ostringstream discard;
+  prog.initInstMem(instMem);
+  cpu.setIO(in, discard);
+  cpu.setStats(full);
+  cpu.run();
+  chrono::duration<double> seq = chrono::steady_clock::now() - t2;
+  report(fast.count(), detail.count(), &full, seq.count());
+  return FAULT_NONE;
+}
+
+void CheckpointSim::report(double fastHost, double detailHost, Stats *full, double fullHost) {
+  Stats total(base);
+  size_t pages = 0;
+  int bad = 0;
+
+  for(size_t k = 0; k < ckpts.size(); k++) {
+    total.addCounters(deltas[k]);
+    pages += ckpts[k].pageIds.size();
+    if(mismatched[k]) bad++;
+  }
+
+  cout << endl << "Checkpointed intervals: " << ckpts.size() << " of " << cfg.interval << " instructions, "
+       << pages << " dirty pages saved (" << pages * CheckpointMemory::PAGE_WORDS * 4 / 1024 << " KB), "
+       << cfg.warm << " records of warmup" << endl;
+  cout << "  functional pass " << fixed << setprecision(2) << fastHost << " s, detailed pass "
+       << detailHost << " s on " << cfg.threads << " thread" << (cfg.threads > 1 ? "s" : "") << endl;
+  if(!base.isMemoizable())
+    cout << "  multi-cycle units or a profile: counters at interval boundaries are approximate" << endl;
+  if(bad)
+    cout << "  " << bad << " intervals did not replay to their end" << endl;
+
+  cout << endl << "Program finished at pc = 0x" << hex << endPc << "  (" << dec << instructions
+       << " instructions executed)" << endl;
+  RunSummary s;
+  total.getSummary(s, instructions);
+  printRunSummary(s);
+
+  if(full) {
+    bool same = full->getCycles() == total.getCycles() && full->getBubbles() == total.getBubbles() &&
+                full->getFlushes() == total.getFlushes();
+    cout << "Full simulation: " << full->getCycles() << " cycles, " << full->getBubbles() << " bubbles, "
+         << full->getFlushes() << " flushes (" << (same ? "identical" : "differs") << "), "
+         << setprecision(2) << fullHost << " s, " << fullHost / (fastHost + detailHost) << "x the checkpointed time" << endl;
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct CheckpointConfig {
+  long interval;   // instructions between checkpoints
+  int threads;     // detailed simulation threads
+  int warm;        // records replayed to rebuild the pipeline state
+  bool verify;
+
+  CheckpointConfig() : interval(1000000), threads(1), warm(4 * PIPESTAGES), verify(false) {}
+};
+
+// Data memory that remembers which pages were written since the last
+// checkpoint
+class CheckpointMemory : public Memory {
+  public:
+    static const int PAGE_WORDS = 1024;
+
+    CheckpointMemory();
+
+    void storeWord(uint32_t data, uint32_t addr);
+
+    int pages() const { return numWords / PAGE_WORDS; }
+    bool isDirty(int p) const { return dirty[p]; }
+    void clearDirty() { dirty.assign(dirty.size(), false); }
+    void savePage(int p, uint32_t *words) const;
+    void loadPage(int p, const uint32_t *words);
+
+  private:
+    vector<bool> dirty;
+};
+
+// Parallel interval simulation.  A functional pass saves a checkpoint
+// every interval instructions: registers, pc, hi/lo, the trap input
+// offset, the data pages written since the previous checkpoint and the
+// last few instruction records.  Each interval is then timed in detail
+// on its own thread, from its checkpoint.  A fresh Stats pipeline is
+// warmed on the saved records, which rebuilds its state exactly as long
+// as all units are single-cycle, and the counter deltas of all intervals
+// are added up.
+class CheckpointSim {
+  public:
+    CheckpointSim(const Program &prog, const Stats &base, const CheckpointConfig &cfg);
+
+    FAULT run(const string &input, ostream &out);
+
+  private:
+    struct Checkpoint {
+      CPUState cpu;
+      size_t inPos;
+      vector<InstRecord> tail;
+      vector<int> pageIds;      // pages written since the previous checkpoint
+      vector<uint32_t> pages;   // their contents, PAGE_WORDS each
+    };
+
+    // keeps the last records of the functional pass
+    class TailSink : public TraceSink {
+      public:
+        TailSink(int size) : ring(size), n(0) {}
+        void consume(const InstRecord &rec) { ring[n++ % ring.size()] = rec; }
+        void copy(vector<InstRecord> &out) const;
+
+      private:
+        vector<InstRecord> ring;
+        long long n;
+    };
+
+    const Program &prog;
+    Stats base;
+    CheckpointConfig cfg;
+    vector<Checkpoint> ckpts;
+    vector<StatsCounters> deltas;   // per interval
+    vector<char> mismatched;        // interval did not end where the functional pass did; not
+                                    // vector<bool>, whose packed bits the workers would race on
+    long long instructions;
+    uint32_t endPc;
+
+    FAULT functional(const string &input, ostream &out);
+    void detailed(size_t k, const string &input);
+    void report(double fastHost, double detailHost, Stats *full, double fullHost);
+};
+
+#endif
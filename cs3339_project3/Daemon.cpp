@@ -0,0 +1,274 @@
+/*
+ * Persistent simulation daemon with an LRU cache of loaded programs.
+ */
+
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <sstream>
+#include <exception>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "Daemon.h"
+#include "ForkServer.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "Stats.h"
+
+static volatile sig_atomic_t quit = 0;
+
+static void onSignal(int) {
+  quit = 1;
+}
+
+shared_ptr<const Program> ProgramCache::get(const string &path, ostream &out) {
+  struct stat st;
+  if(stat(path.c_str(), &st) < 0) {
+    out << "error: could not open executable file " << path << endl;
+    return NULL;
+  }
+
+  {
+    lock_guard<mutex> g(lock);
+    unordered_map<string, Entry>::iterator it = entries.find(path);
+    if(it != entries.end() && it->second.size == st.st_size && it->second.mtime == st.st_mtime) {
+      order.splice(order.begin(), order, it->second.use);
+      hits++;
+      return it->second.prog;
+    }
+  }
+
+  // load outside the lock; two jobs may both load a new binary, the
+  // second one's copy simply replaces the first.  Details go to the log.
+  Program *p = new Program;
+  if(!p->load(path.c_str())) {
+    out << "error: could not load " << path << endl;
+    delete p;
+    return NULL;
+  }
+  shared_ptr<const Program> prog(p);
+
+  lock_guard<mutex> g(lock);
+  misses++;
+  unordered_map<string, Entry>::iterator it = entries.find(path);
+  if(it != entries.end())
+    order.erase(it->second.use);
+  order.push_front(path);
+  Entry &e = entries[path];
+  e.prog = prog;
+  e.size = st.st_size;
+  e.mtime = st.st_mtime;
+  e.use = order.begin();
+
+  while(entries.size() > capacity) {
+    entries.erase(order.back());
+    order.pop_back();
+    evictions++;
+  }
+  return prog;
+}
+
+// ostream onto a socket, flushed whenever the buffer fills or on endl
+class FdStreamBuf : public streambuf {
+  public:
+    FdStreamBuf(int fd) : fd(fd) { setp(buf, buf + sizeof(buf)); }
+    ~FdStreamBuf() { sync(); }
+
+  protected:
+    int overflow(int c) {
+      if(sync() < 0) return EOF;
+      if(c != EOF) {
+        *pptr() = c;
+        pbump(1);
+      }
+      return c == EOF ? 0 : c;
+    }
+    int sync() {
+      bool ok = writeAll(fd, pbase(), pptr() - pbase());
+      setp(buf, buf + sizeof(buf));
+      return ok ? 0 : -1;
+    }
+
+  private:
+    int fd;
+    char buf[4096];
+};
+
+Daemon::Daemon(const char *path, const DaemonConfig &cfg)
+    : path(path), cfg(cfg), cache(cfg.cacheSize), done(false), jobs(0), failed(0) {}
+
+int Daemon::serve() {
+  int sock = listenSocket(path.c_str());
+  if(sock < 0)
+    return -1;
+
+  // signals go to this thread only: block them while the workers start
+  sigset_t sigs, old;
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &sigs, &old);
+  vector<thread> workers;
+  for(int w = 0; w < cfg.threads; w++)
+    workers.push_back(thread(&Daemon::work, this));
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  // no SA_RESTART, so a signal gets accept() out of its wait
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);   // a client that goes away must not end the daemon
+
+  cerr << "daemon: " << cfg.threads << " worker thread" << (cfg.threads > 1 ? "s" : "")
+       << ", " << cfg.cacheSize << " cached programs, listening on " << path << endl;
+  while(!quit) {
+    int conn = accept(sock, NULL, NULL);
+    if(conn < 0) {
+      if(errno != EINTR) cerr << "daemon: accept: " << strerror(errno) << endl;
+      continue;
+    }
+    lock_guard<mutex> g(lock);
+    pending.push_back(conn);
+    ready.notify_one();
+  }
+
+  close(sock);
+  unlink(path.c_str());
+  {
+    lock_guard<mutex> g(lock);
+    done = true;
+  }
+  ready.notify_all();
+  for(size_t w = 0; w < workers.size(); w++)
+    workers[w].join();
+
+  cerr << "daemon: stopped after " << jobs << " jobs (" << failed << " failed), program cache "
+       << cache.getHits() << " hits, " << cache.getMisses() << " loads, " << cache.getEvictions()
+       << " evictions" << endl;
+  return 0;
+}
+
+// queued jobs are finished before a worker stops
+void Daemon::work() {
+  for(;;) {
+    int conn;
+    {
+      unique_lock<mutex> g(lock);
+      ready.wait(g, [this] { return done || !pending.empty(); });
+      if(pending.empty()) return;
+      conn = pending.front();
+      pending.pop_front();
+    }
+    int rc;
+    try {
+      rc = runJob(conn);
+    }
+    catch(const exception &e) {
+      // one bad job (e.g. out of memory) must not take the daemon down
+      string msg = string("error: ") + e.what() + "\n";
+      writeAll(conn, msg.data(), msg.size());
+      cerr << "daemon: job failed: " << e.what() << endl;
+      rc = -1;
+    }
+    writeStatus(conn, rc);
+    close(conn);
+
+    lock_guard<mutex> g(lock);
+    jobs++;
+    if(rc) failed++;
+  }
+}
+
+int Daemon::runJob(int conn) {
+  // a stalled read or write fails after the timeout instead of blocking
+  timeval tv;
+  tv.tv_sec = cfg.ioTimeout;
+  tv.tv_usec = 0;
+  setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  vector<string> args;
+  splitArgs(readLine(conn), args);
+
+  // the input has been sent in full once the client shuts down its side
+  string input;
+  char buf[65536];
+  ssize_t n;
+  while((n = read(conn, buf, sizeof(buf))) > 0)
+    input.append(buf, n);
+  int err = errno;
+
+  FdStreamBuf sb(conn);
+  ostream out(&sb);
+  FUConfig fu;
+  bool cpiStack = false;
+
+  out << "CS 3339 MIPS Simulator" << endl;
+  if(n < 0) {
+    if(err == EAGAIN || err == EWOULDBLOCK)
+      out << "error: the input did not end within " << cfg.ioTimeout << " s" << endl;
+    else
+      out << "error: reading the input: " << strerror(err) << endl;
+    return -1;
+  }
+  if(args.empty()) {
+    out << "error: no executable given" << endl;
+    return -1;
+  }
+  for(size_t i = 0; i + 1 < args.size(); i++) {
+    if(args[i] == "--fu" && i + 2 < args.size() && parseFUSpec(args[i + 1].c_str(), fu))
+      i++;
+    else if(args[i] == "--cpi-stack")
+      cpiStack = true;
+    else {
+      out << "error: option " << args[i] << " is not supported by the daemon (--fu, --cpi-stack)" << endl;
+      return -1;
+    }
+  }
+
+  shared_ptr<const Program> prog = cache.get(args.back(), out);
+  if(!prog)
+    return -1;
+
+  Memory instMem(prog->instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  PipelineCPU cpu(prog->start, instMem, dataMem);
+  Stats stats;
+  istringstream in(input);
+
+  stats.setFU(fu);
+  prog->initInstMem(instMem);
+  cpu.setStats(stats);
+  cpu.setIO(in, out);
+
+  out << "Running: " << prog->name << endl << endl;
+  while(!cpu.isStopped()) {
+    long long limit = cpu.getInstructions() + CHECK_EVERY;
+    if(cfg.maxInstructions && limit > cfg.maxInstructions)
+      limit = cfg.maxInstructions;
+    if(cpu.run(limit) != FAULT_NONE) {
+      // the detailed message went to the shared log, so say why here too
+      out << endl << "error: " << faultName(cpu.getFault()) << " at instruction " << cpu.getInstructions() << endl;
+      return -1;
+    }
+    if(!out) {
+      // nobody is reading the output any more
+      cerr << "daemon: job stopped at instruction " << cpu.getInstructions() << ", writing to the client failed" << endl;
+      return -1;
+    }
+    if(!cpu.isStopped() && cpu.getInstructions() == cfg.maxInstructions) {
+      out << endl << "error: stopped at the limit of " << cfg.maxInstructions << " instructions" << endl;
+      return -1;
+    }
+  }
+  out << endl;
+  cpu.printFinalStats(out);
+  if(cpiStack) stats.printCPIStack(cpu.getInstructions(), out);
+  out.flush();
+  return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef __DAEMON_H
+#define __DAEMON_H
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Program.h"
+#include "Debug.h"
+using namespace std;
+
+struct DaemonConfig {
+  int threads;                 // jobs run at once
+  int cacheSize;               // programs kept loaded
+  long long maxInstructions;   // per job, 0 for no limit
+  int ioTimeout;               // seconds a client may stall sending input or reading the reply
+
+  DaemonConfig() : threads(thread::hardware_concurrency() ? thread::hardware_concurrency() : 1), cacheSize(16),
+                   maxInstructions(10000000000LL), ioTimeout(30) {}
+};
+
+// Loaded programs by path, least recently used evicted first.  An entry
+// is reloaded when the file's size or modification time changes; jobs
+// hold shared pointers, so eviction never pulls an image out from under
+// a running job.
+class ProgramCache {
+  public:
+    ProgramCache(int capacity) : capacity(capacity), hits(0), misses(0), evictions(0) {}
+
+    // NULL, with a message on out, if the file can't be loaded
+    shared_ptr<const Program> get(const string &path, ostream &out);
+
+    long long getHits() const { return hits; }
+    long long getMisses() const { return misses; }
+    long long getEvictions() const { return evictions; }
+
+  private:
+    struct Entry {
+      shared_ptr<const Program> prog;
+      int64_t size, mtime;
+      list<string>::iterator use;
+    };
+
+    mutex lock;
+    size_t capacity;
+    list<string> order;   // most recently used first
+    unordered_map<string, Entry> entries;
+    long long hits, misses, evictions;
+};
+
+// Long-running simulation service on a Unix domain socket.  A job is one
+// line "[options] binary.mips" followed by the trap input, the same
+// request --client sends.  Jobs run in this process on a fixed set of
+// worker threads, each with its own memories, CPU and Stats; guest output
+// and the final statistics are streamed back as they are produced,
+// followed by the status trailer (see writeStatus).  Options:
+// --fu OP:LAT[:np] and --cpi-stack.  A job fails once it runs past
+// maxInstructions, or when its client stalls for ioTimeout or goes away,
+// so no client can tie up a worker for good.
+class Daemon {
+  public:
+    Daemon(const char *path, const DaemonConfig &cfg);
+
+    int serve();   // returns once SIGINT or SIGTERM arrives
+
+  private:
+    string path;
+    DaemonConfig cfg;
+    ProgramCache cache;
+
+    mutex lock;
+    condition_variable ready;
+    deque<int> pending;   // accepted connections
+    bool done;
+    long long jobs, failed;
+
+    static const long long CHECK_EVERY = 1 << 20;   // instructions between limit and client checks
+
+    void work();
+    int runJob(int conn);
+};
+
+#endif
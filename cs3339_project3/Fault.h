@@ -0,0 +1,16 @@
+#ifndef __FAULT_H
+#define __FAULT_H
+
+#include "Debug.h"
+
+// Fatal guest errors.  The component that detects one reports it on cerr
+// and records it; the CPU then stops and returns it from run(), leaving
+// the host free to carry on with other simulations.
+enum FAULT { FAULT_NONE = 0, FAULT_DIV_ZERO, FAULT_UNALIGNED, FAULT_RANGE };
+
+inline const char *faultName(FAULT f) {
+  static const char *names[] = { "none", "division by zero", "unaligned access", "access out of range" };
+  return names[f];
+}
+
+#endif
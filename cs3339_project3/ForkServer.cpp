@@ -0,0 +1,208 @@
+/*
+ * Fork server: prepare once, fork a child per simulation request.
+ */
+
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "ForkServer.h"
+
+static volatile sig_atomic_t quit = 0;
+
+static void onSignal(int) {
+  quit = 1;
+}
+
+static bool socketAddress(const char *path, sockaddr_un &addr) {
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    cerr << "error: socket path too long: " << path << endl;
+    return false;
+  }
+  strcpy(addr.sun_path, path);
+  return true;
+}
+
+bool writeAll(int fd, const char *buf, size_t n) {
+  while(n > 0) {
+    ssize_t w = write(fd, buf, n);
+    if(w < 0 && errno == EINTR) continue;
+    if(w <= 0) return false;
+    buf += w;
+    n -= w;
+  }
+  return true;
+}
+
+bool writeStatus(int fd, int rc) {
+  char trailer[STATUS_MARK_LEN + 1];
+  memcpy(trailer, STATUS_MARK, STATUS_MARK_LEN);
+  trailer[STATUS_MARK_LEN] = rc;
+  return writeAll(fd, trailer, sizeof(trailer));
+}
+
+ForkServer::ForkServer(const char *path, const vector<string> &base, Simulate simulate)
+    : path(path), base(base), simulate(simulate), served(0) {}
+
+int listenSocket(const char *path) {
+  sockaddr_un addr;
+  if(!socketAddress(path, addr))
+    return -1;
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  if(sock < 0 || bind(sock, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(sock, 64) < 0) {
+    cerr << "error: could not listen on " << path << ": " << strerror(errno) << endl;
+    if(sock >= 0) close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+// read a byte at a time so nothing after the newline is taken
+string readLine(int fd) {
+  string line;
+  char c;
+  while(read(fd, &c, 1) == 1 && c != '\n')
+    line += c;
+  return line;
+}
+
+void splitArgs(const string &line, vector<string> &args) {
+  size_t b = 0;
+  while((b = line.find_first_not_of(" \t\r", b)) != string::npos) {
+    size_t e = line.find_first_of(" \t\r", b);
+    args.push_back(line.substr(b, e == string::npos ? string::npos : e - b));
+    b = e;
+  }
+}
+
+int ForkServer::serve() {
+  int sock = listenSocket(path.c_str());
+  if(sock < 0)
+    return -1;
+
+  // no SA_RESTART, so a signal gets accept() out of its wait
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  cerr << "fork server: " << base.back() << " ready on " << path << endl;
+  while(!quit) {
+    int conn = accept(sock, NULL, NULL);
+    int err = errno;
+
+    // reap finished children
+    int status;
+    pid_t pid;
+    while((pid = waitpid(-1, &status, WNOHANG)) > 0)
+      if(WIFSIGNALED(status))
+        cerr << "fork server: child " << pid << " killed by signal " << WTERMSIG(status) << endl;
+
+    if(conn < 0) {
+      if(err != EINTR) cerr << "fork server: accept: " << strerror(err) << endl;
+      continue;
+    }
+
+    // nothing buffered may be inherited twice
+    cout.flush();
+    cerr.flush();
+    pid = fork();
+    if(pid == 0) {
+      close(sock);
+      child(conn);
+    }
+    if(pid < 0) cerr << "fork server: fork: " << strerror(errno) << endl;
+    else served++;
+    close(conn);
+  }
+
+  close(sock);
+  unlink(path.c_str());
+  while(wait(NULL) > 0);
+  cerr << "fork server: stopped after " << served << " requests" << endl;
+  return 0;
+}
+
+// never returns
+void ForkServer::child(int conn) {
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+
+  vector<string> args(base.begin(), base.end() - 1);
+  splitArgs(readLine(conn), args);
+  args.push_back(base.back());
+
+  vector<char *> argv;
+  for(size_t i = 0; i < args.size(); i++)
+    argv.push_back(&args[i][0]);
+  argv.push_back(NULL);
+
+  // stderr too, so that option errors and warnings reach the client
+  dup2(conn, 0);
+  dup2(conn, 1);
+  dup2(conn, 2);
+  close(conn);
+  cin.clear();
+
+  int rc = simulate(argv.size() - 1, argv.data());
+  cout.flush();
+  writeStatus(1, rc);
+  _exit(0);
+}
+
+int forkClient(const char *path, int argc, char *argv[]) {
+  sockaddr_un addr;
+  if(!socketAddress(path, addr))
+    return -1;
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(sock < 0 || connect(sock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    cerr << "error: could not connect to " << path << ": " << strerror(errno) << endl;
+    return -1;
+  }
+
+  string line;
+  for(int i = 0; i < argc; i++)
+    line += string(i ? " " : "") + argv[i];
+  line += '\n';
+
+  // the child may exit before reading all the input (a bad option, say);
+  // then stop sending, but still read what it replied
+  signal(SIGPIPE, SIG_IGN);
+  char buf[65536];
+  ssize_t n;
+  bool ok = writeAll(sock, line.data(), line.size());
+  while(ok && (n = read(0, buf, sizeof(buf))) > 0)
+    ok = writeAll(sock, buf, n);
+  shutdown(sock, SHUT_WR);
+
+  // hold back as much as the trailer could take up
+  const size_t keep = STATUS_MARK_LEN + 1;
+  string tail;
+  bool replied = false;
+  while((n = read(sock, buf, sizeof(buf))) > 0) {
+    replied = true;
+    tail.append(buf, n);
+    if(tail.size() > keep) {
+      writeAll(1, tail.data(), tail.size() - keep);
+      tail.erase(0, tail.size() - keep);
+    }
+  }
+  close(sock);
+  if(tail.size() == keep && !memcmp(tail.data(), STATUS_MARK, STATUS_MARK_LEN))
+    return (signed char)tail[STATUS_MARK_LEN];
+
+  writeAll(1, tail.data(), tail.size());
+  cout.flush();
+  if(replied) cerr << "error: no status at the end of the reply from " << path << endl;
+  else cerr << "error: no reply from " << path << endl;
+  return -1;
+}
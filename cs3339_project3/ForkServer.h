@@ -0,0 +1,50 @@
+#ifndef __FORKSERVER_H
+#define __FORKSERVER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Debug.h"
+using namespace std;
+
+// Serves simulation requests on a Unix domain socket, forking a
+// copy-on-write child of the already prepared process for each one.  A
+// request is one line of extra options followed by the trap input; the
+// connection is closed for writing at the end of the input.  The child
+// runs the simulation with its stdin, stdout and stderr on the connection
+// and ends the reply with the status trailer (see writeStatus).
+class ForkServer {
+  public:
+    typedef int (*Simulate)(int argc, char *argv[]);
+
+    // base: argv[0], the server's own options and the program, in that order
+    ForkServer(const char *path, const vector<string> &base, Simulate simulate);
+
+    int serve();   // returns once SIGINT or SIGTERM arrives
+
+  private:
+    string path;
+    vector<string> base;
+    Simulate simulate;
+    long long served;
+
+    void child(int conn);
+};
+
+// Unix domain socket helpers, also used by Daemon
+int listenSocket(const char *path);   // -1, with a message, on failure
+bool writeAll(int fd, const char *buf, size_t n);
+string readLine(int fd);
+
+// The end of a reply: STATUS_MARK, then one byte holding the exit status.
+// A reply without it was cut short.
+const char STATUS_MARK[] = { '\0', 'S', 'T', 'A', 'T', 'U', 'S', '\0' };
+const size_t STATUS_MARK_LEN = sizeof(STATUS_MARK);
+bool writeStatus(int fd, int rc);
+void splitArgs(const string &line, vector<string> &args);
+
+// Sends one request (argv as the options, stdin as the input) and copies
+// the reply to stdout; returns the simulation's exit status
+int forkClient(const char *path, int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * First-order interval model of the in-order pipeline.
+ */
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include "IntervalModel.h"
+#include "CPU.h"
+#include "Memory.h"
+
+IntervalModel::IntervalModel() {
+  n = 0;
+  for(int r = 0; r < 33; r++) {
+    lastWriter[r] = -1;
+    writerIsLoad[r] = false;
+  }
+  now.taken = now.mispredicted = now.jumps = now.jrs = 0;
+  for(int b = 0; b < BHT; b++)
+    bht[b] = 1;
+  flat = false;
+}
+
+// 14 bits per source: distance (5), load (1), then taken, mispredicted,
+// jump and jr counts in between (2 each).  0 means no hazard at all.
+uint32_t IntervalModel::pack(int r) const {
+  if(r <= 0 || lastWriter[r] < 0) return 0;
+  long long d = n - lastWriter[r];
+  if(d >= MAXDIST) return 0;
+  const Redirects &w = atWrite[r];
+  uint32_t k = d << 1 | (writerIsLoad[r] ? 1 : 0);
+  k = k << 2 | min(now.taken - w.taken, (long long)MAXREDIR);
+  k = k << 2 | min(now.mispredicted - w.mispredicted, (long long)MAXREDIR);
+  k = k << 2 | min(now.jumps - w.jumps, (long long)MAXREDIR);
+  k = k << 2 | min(now.jrs - w.jrs, (long long)MAXREDIR);
+  return k;
+}
+
+void IntervalModel::consume(const InstRecord &rec) {
+  uint32_t key = pack(rec.src[0]) << 14 | pack(rec.src[1]);
+  hist[key]++;
+  flat = false;
+
+  if(rec.dest > 0) {
+    lastWriter[rec.dest] = n;
+    writerIsLoad[rec.dest] = rec.flags & REC_LOAD;
+    atWrite[rec.dest] = now;
+  }
+
+  // redirects count from the instruction causing them onwards
+  if(rec.flags & REC_BRANCH) {
+    int b = (rec.pc >> 2) & (BHT - 1);
+    bool taken = rec.flags & REC_TAKEN;
+    if((bht[b] >> 1) != taken) now.mispredicted++;
+    if(taken) now.taken++;
+    bht[b] = taken ? min(bht[b] + 1, 3) : max(bht[b] - 1, 0);
+  }
+  else if(rec.flags & REC_JUMP) now.jumps++;
+  else if(rec.flags & REC_JR) now.jrs++;
+  n++;
+}
+
+void IntervalModel::estimate(const PipeConfig &c, IntervalEstimate &e) const {
+  if(!flat) {
+    buckets.clear();
+    for(unordered_map<uint32_t, long long>::const_iterator it = hist.begin(); it != hist.end(); ++it) {
+      Bucket b = { it->first, it->second };
+      buckets.push_back(b);
+    }
+    flat = true;
+  }
+
+  double stall = 0.0;
+  for(size_t i = 0; i < buckets.size(); i++) {
+    int worst = 0;
+    for(int s = 0; s < 2; s++) {
+      uint32_t k = buckets[i].key >> (s ? 0 : 14) & 0x3fff;
+      if(!k) continue;
+      int jrs = k & 3, jumps = k >> 2 & 3, mis = k >> 4 & 3, tk = k >> 6 & 3;
+      int load = k >> 8 & 1, dist = k >> 9;
+      int branches = c.predictor == PRED_NOT_TAKEN ? tk : c.predictor == PRED_BIMODAL ? mis : 0;
+      int covered = dist + branches * c.branchPenalty + jumps * c.jumpPenalty + jrs * c.jrPenalty;
+      worst = max(worst, (load ? c.loadDist : c.aluDist) - covered);
+    }
+    stall += (double)worst * buckets[i].count;
+  }
+
+  long long redirects = c.predictor == PRED_NOT_TAKEN ? now.taken
+                      : c.predictor == PRED_BIMODAL ? now.mispredicted : 0;
+  e.bubbles = stall;
+  e.flushes = (double)redirects * c.branchPenalty + (double)now.jumps * c.jumpPenalty
+            + (double)now.jrs * c.jrPenalty;
+  e.cycles = n + (c.depth - 1) + e.bubbles + e.flushes;
+}
+
+FAULT IntervalModel::run(const Program &prog, istream &in, ostream &out, TraceSink *also) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  CPU cpu(prog.start, instMem, dataMem);
+  TraceFanout sinks;
+
+  sinks.add(this);
+  if(also) sinks.add(also);
+  prog.initInstMem(instMem);
+  cpu.setIO(in, out);
+  cpu.setTraceSink(&sinks);
+  return cpu.run();
+}
+
+void IntervalModel::printReport(const vector<PipeConfig> &cfgs, const MultiTiming *detailed) const {
+  vector<IntervalEstimate> est(cfgs.size());
+  double worst = 0.0, sumErr = 0.0;
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for(size_t i = 0; i < cfgs.size(); i++)
+    estimate(cfgs[i], est[i]);
+  chrono::duration<double, micro> host = chrono::steady_clock::now() - t0;
+
+  cout << endl << "Interval model: " << n << " instructions profiled, " << buckets.size()
+       << " histogram buckets, " << cfgs.size() << " configurations estimated in "
+       << fixed << setprecision(1) << host.count() << " us" << endl;
+  cout << "  " << setw(12) << left << "config" << right << setw(10) << "est. CPI";
+  if(detailed) cout << setw(10) << "CPI" << setw(9) << "error";
+  cout << setw(14) << "est. bubbles" << setw(14) << "est. flushes" << endl;
+  for(size_t i = 0; i < cfgs.size(); i++) {
+    cout << "  " << setw(12) << left << cfgs[i].name << right << setw(10) << setprecision(3) << est[i].cycles / n;
+    if(detailed) {
+      double err = 100.0 * (est[i].cycles - detailed->getCycles(i)) / detailed->getCycles(i);
+      cout << setw(10) << (double)detailed->getCycles(i) / n << setw(8) << setprecision(1) << err << "%";
+      worst = max(worst, fabs(err));
+      sumErr += fabs(err);
+    }
+    cout << setw(14) << setprecision(0) << est[i].bubbles << setw(14) << est[i].flushes << endl;
+  }
+  if(detailed)
+    cout << "  mean |error| " << setprecision(1) << sumErr / cfgs.size() << "%, worst " << worst << "%" << endl;
+}
+
+void IntervalModel::prune(vector<PipeConfig> &cfgs, size_t keep) const {
+  vector<pair<double, size_t> > order;
+  vector<PipeConfig> kept;
+
+  for(size_t i = 0; i < cfgs.size(); i++) {
+    IntervalEstimate e;
+    estimate(cfgs[i], e);
+    order.push_back(make_pair(e.cycles, i));
+  }
+  sort(order.begin(), order.end());
+  for(size_t i = 0; i < order.size() && i < keep; i++)
+    kept.push_back(cfgs[order[i].second]);
+  cfgs.swap(kept);
+}
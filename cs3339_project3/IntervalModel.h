@@ -0,0 +1,75 @@
+#ifndef __INTERVALMODEL_H
+#define __INTERVALMODEL_H
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include "Trace.h"
+#include "Program.h"
+#include "PipeConfig.h"
+#include "MultiTiming.h"
+#include "Debug.h"
+using namespace std;
+
+struct IntervalEstimate {
+  double cycles, bubbles, flushes;
+};
+
+// Analytical CPI for any PipeConfig from one functional profile.  For
+// every instruction and source register the profile records the distance
+// back to the value's producer, whether that was a load, and how many
+// redirects (taken branches, bimodal mispredictions, jumps, jrs) came in
+// between, since those already cover part of the wait.  The stall of an
+// instruction is then the largest result distance not yet covered, and a
+// configuration is costed by summing over the histogram without touching
+// the trace again.  Stalls of the instructions in between are not
+// credited, so the estimate errs towards more bubbles.
+class IntervalModel : public TraceSink {
+  public:
+    static const int MAXDIST = MAX_RESULT_DIST;   // farther producers stall no config
+    static const int MAXREDIR = 3;   // as are redirect counts
+    static const int BHT = 1024;     // same bimodal table as MultiTiming
+
+    IntervalModel();
+
+    // functional pass over prog feeding this model (and also, if given);
+    // returns the guest fault that stopped it, if any
+    FAULT run(const Program &prog, istream &in, ostream &out, TraceSink *also = NULL);
+    void consume(const InstRecord &rec);
+    void estimate(const PipeConfig &c, IntervalEstimate &e) const;
+
+    // estimates for cfgs, next to the detailed results when available
+    void printReport(const vector<PipeConfig> &cfgs, const MultiTiming *detailed) const;
+    // keeps the keep configurations with the lowest estimated CPI
+    void prune(vector<PipeConfig> &cfgs, size_t keep) const;
+
+    long long getInstructions() const { return n; }
+    size_t getBuckets() const { return buckets.size(); }
+
+  private:
+    // cumulative redirect counts, per kind
+    struct Redirects {
+      long long taken, mispredicted, jumps, jrs;
+    };
+
+    struct Bucket {
+      uint32_t key;      // two packed sources, see pack()
+      long long count;
+    };
+
+    long long n;
+    long long lastWriter[33];
+    bool writerIsLoad[33];
+    Redirects atWrite[33];
+    Redirects now;
+    uint8_t bht[BHT];
+
+    unordered_map<uint32_t, long long> hist;
+    mutable vector<Bucket> buckets;   // hist flattened for estimate()
+    mutable bool flat;
+
+    uint32_t pack(int r) const;
+};
+
+#endif
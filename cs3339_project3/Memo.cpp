@@ -0,0 +1,73 @@
+/*
+ * Block-level timing memoization on top of the Stats pipeline model.
+ */
+
+#include "Memo.h"
+#include "Profile.h"
+
+TimingMemo::TimingMemo(Stats &model) : model(model) {
+  block.reserve(MAX_BLOCK);
+  hits = misses = hitInsts = 0;
+}
+
+void TimingMemo::consume(const InstRecord &rec) {
+  block.push_back(rec);
+  if(rec.flags & (REC_BRANCH | REC_JUMP | REC_JR))
+    endBlock(rec.flags & REC_TAKEN);
+  else if(block.size() == MAX_BLOCK)
+    endBlock(false);
+}
+
+// key: 35 bits of pipeline state, the taken bit and the leader's text index
+void TimingMemo::endBlock(bool taken) {
+  uint64_t in = model.getPipeState();
+  uint64_t key = (uint64_t)PCProfile::index(block[0].pc) << 36 | (uint64_t)taken << 35 | in;
+
+  unordered_map<uint64_t, Entry>::iterator it = table.find(key);
+  if(it != table.end()) {
+    model.addCounters(it->second.delta);
+    model.setPipeState(it->second.outState);
+    hits++;
+    hitInsts += block.size();
+  }
+  else {
+    StatsCounters before, after;
+    Entry e;
+
+    model.getCounters(before);
+    for(size_t i = 0; i < block.size(); i++)
+      model.process(block[i]);
+    model.getCounters(after);
+
+    e.delta.cycles = after.cycles - before.cycles;
+    e.delta.bubbles = after.bubbles - before.bubbles;
+    e.delta.flushes = after.flushes - before.flushes;
+    e.delta.memops = after.memops - before.memops;
+    e.delta.branches = after.branches - before.branches;
+    e.delta.taken = after.taken - before.taken;
+    for(int i = 0; i < STALL_CAUSES; i++)
+      e.delta.stalls[i] = after.stalls[i] - before.stalls[i];
+    e.outState = model.getPipeState();
+    table[key] = e;
+    misses++;
+  }
+  block.clear();
+}
+
+void TimingMemo::finish() {
+  for(size_t i = 0; i < block.size(); i++)
+    model.process(block[i]);
+  block.clear();
+}
+
+void TimingMemo::printFinalStats() {
+  long long lookups = hits + misses;
+  // node = key + entry + next pointer + cached hash, plus one bucket pointer
+  size_t bytes = table.size() * (sizeof(uint64_t) + sizeof(Entry) + 2 * sizeof(void *))
+               + table.bucket_count() * sizeof(void *);
+
+  cout << "Timing memo: " << table.size() << " entries, ~" << (bytes + 1023) / 1024 << " KB" << endl;
+  cout << "  block hit rate: " << fixed << setprecision(2)
+       << (lookups ? 100.0 * hits / lookups : 0.0) << "% (" << hits << " of " << lookups << "), "
+       << hitInsts << " instructions not timed" << endl;
+}
@@ -0,0 +1,45 @@
+#ifndef __MEMO_H
+#define __MEMO_H
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+// Timing memoization for Stats.  The pipeline model is deterministic: the
+// cycles, bubbles and flushes of a basic block and the pipeline state it
+// leaves behind depend only on the block and the state it starts from.
+// Records are buffered up to the end of each block; the block is then
+// looked up by (leader pc, branch outcome, incoming pipeline state).  A
+// hit adds the stored counter deltas and installs the stored outgoing
+// state without evaluating any hazards; a miss runs the block through
+// Stats and remembers the result.
+class TimingMemo : public TraceSink {
+  public:
+    static const int MAX_BLOCK = 64;   // split long straight-line runs
+
+    TimingMemo(Stats &model);
+
+    void consume(const InstRecord &rec);
+    void finish();   // time a trailing partial block
+    void printFinalStats();
+
+  private:
+    struct Entry {
+      StatsCounters delta;
+      uint64_t outState;
+    };
+
+    Stats &model;
+    unordered_map<uint64_t, Entry> table;
+    vector<InstRecord> block;
+    long long hits, misses, hitInsts;
+
+    void endBlock(bool taken);
+};
+
+#endif
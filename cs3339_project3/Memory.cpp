@@ -15,64 +15,88 @@ Memory::Memory(int numBytes, uint32_t offset, bool isDataMem) {
   
   this->isDataMem = isDataMem;
   type = isDataMem ? "data" : "inst";
+  fault = FAULT_NONE;
 
   mem = new uint32_t[numWords];
+  ownsWords = true;
   if(!mem) {
     cerr << "error: out of memory" << endl;
     exit(-1);
   }
 }
 
-void Memory::storeWord(uint32_t data, uint32_t addr) {
+Memory::Memory(const Memory *shared) {
+  mem = shared->mem;
+  offset = shared->offset;
+  numBytes = shared->numBytes;
+  numWords = shared->numWords;
+  isDataMem = shared->isDataMem;
+  type = shared->type;
+  fault = FAULT_NONE;
+  ownsWords = false;
+}
+
+int Memory::wordIndex(uint32_t addr, bool isStore) {
   if((addr & 3) != 0) {
-    cerr << "unaligned " << type << " access: 0x" << hex << addr << endl;
-    exit(-1);
+    cerr << "unaligned " << type << (isStore ? " access: 0x" : " memory access: 0x") << hex << addr << dec << endl;
+    fault = FAULT_UNALIGNED;
+    return -1;
   }
 
   uint32_t index = (addr - offset) >> 2;
-  if(index >= numWords) {
-    cerr << type << " memory access out of range: 0x" << hex << addr << endl;
-    exit(-1);
+  if(index >= (uint32_t)numWords) {
+    cerr << type << " memory access out of range: 0x" << hex << addr << dec << endl;
+    fault = FAULT_RANGE;
+    return -1;
   }
+  return index;
+}
+
+void Memory::storeWord(uint32_t data, uint32_t addr) {
+  int index = wordIndex(addr, true);
+  if(index < 0) return;
 
   D(if(isDataMem) cout << "    MEM WR: addr = 0x" << hex << addr << ", data = 0x" << data << dec << endl);
   mem[index] = data;
 }
 
 uint32_t Memory::loadWord(uint32_t addr) {
-  if((addr & 3) != 0) {
-    cerr << "unaligned " << type << " memory access: 0x" << hex << addr << endl;
-    exit(-1);
-  }
-
-  uint32_t index = (addr - offset) >> 2;
-  if(index >= numWords) {
-    cerr << type << " memory access out of range: 0x" << hex << addr << endl;
-    exit(-1);
-  }
+  int index = wordIndex(addr, false);
+  if(index < 0) return 0;
 
   D(if(isDataMem) cout << "    MEM RD: addr = 0x" << hex << addr << ", data = 0x" << mem[index] << dec << endl);
   return mem[index];
-
 }
 
 uint32_t Memory::swizzle(uint8_t *bytes) {
   return (bytes[0] << 24) | (bytes[1] << 16) | bytes[2] << 8 | bytes[3];
 }
 
-void Memory::initFromExe(ifstream &exeFile, int count) {
+bool Memory::initFromExe(ifstream &exeFile, int count) {
   uint8_t bytes[4];
 
   if(count > numWords) {
     cerr << "allocated " << type << " array not big enough for " << count << " words" << endl;
-    exit(-1);
+    return false;
   }
 
   for(int i = 0; i < count; i++) {
     if(!exeFile.read((char *)&bytes, 4)) {
       cerr << "error: could not read words from file" << endl;
-      exit(-1);
+      return false;
     }
     mem[i] = swizzle(bytes);
   }
+  return true;
+}
+
+bool Memory::initFromWords(const uint32_t *words, int count) {
+  if(count > numWords) {
+    cerr << "allocated " << type << " array not big enough for " << count << " words" << endl;
+    return false;
+  }
+
+  for(int i = 0; i < count; i++)
+    mem[i] = words[i];
+  return true;
 }
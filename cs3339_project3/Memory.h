@@ -7,28 +7,63 @@
 #include <string>
 #include <iomanip>
 #include <cstdlib>
+#include "Fault.h"
 #include "Debug.h"
 using namespace std;
 
+const int MEMSIZE = 1 << 20; // 2^20, data memory size
+const uint32_t TEXT_BASE = 0x400000;
+const uint32_t DATA_BASE = 0x10000000;
+
 class Memory {
-  private:
+  protected:
     uint32_t *mem;
     uint32_t offset;
     int numBytes;
     int numWords;
     bool isDataMem;
+    bool ownsWords;
     string type;
+    FAULT fault;
+
+    // a view onto shared's words (see Multicore), which it does not own
+    explicit Memory(const Memory *shared);
+
+    // word index of addr, or -1 (and a fault) if it is not accessible
+    int wordIndex(uint32_t addr, bool isStore);
 
   public:
     Memory(int numBytes, uint32_t offset, bool isDataMem);
+    virtual ~Memory() { if(ownsWords) delete[] mem; }
 
     int getSize() const { return numBytes; }
+    FAULT getFault() const { return fault; }
     
-    void storeWord(uint32_t data, uint32_t addr);
-    uint32_t loadWord(uint32_t addr);
-    
+    virtual void storeWord(uint32_t data, uint32_t addr);
+    virtual uint32_t loadWord(uint32_t addr);
+
+    // ll/sc; with only one core nothing can break the reservation
+    virtual uint32_t loadLinked(uint32_t addr) { return loadWord(addr); }
+    virtual bool storeConditional(uint32_t data, uint32_t addr) { storeWord(data, addr); return true; }
+
+    // the plain accesses, bound at compile time so they inline; only for
+    // callers that know they have a Memory and not a subclass
+    uint32_t loadWordDirect(uint32_t addr) {
+      uint32_t index = (addr - offset) >> 2;
+      D(return Memory::loadWord(addr));
+      if((addr & 3) == 0 && index < (uint32_t)numWords) return mem[index];
+      return Memory::loadWord(addr);   // reports the fault
+    }
+    void storeWordDirect(uint32_t data, uint32_t addr) {
+      uint32_t index = (addr - offset) >> 2;
+      D(Memory::storeWord(data, addr); return);
+      if((addr & 3) == 0 && index < (uint32_t)numWords) mem[index] = data;
+      else Memory::storeWord(data, addr);
+    }
+
     static uint32_t swizzle(uint8_t *bytes);
-    void initFromExe(ifstream &exeFile, int count);
+    bool initFromExe(ifstream &exeFile, int count);
+    bool initFromWords(const uint32_t *words, int count);
 };
 
 #endif
@@ -0,0 +1,138 @@
+/*
+ * Multi-configuration in-order timing, one configuration per SIMD lane.
+ */
+
+#include <cstring>
+#include "MultiTiming.h"
+
+MultiTiming::MultiTiming(const vector<PipeConfig> &cfgs)
+    : cfgs(cfgs), groups((cfgs.size() + LANES - 1) / LANES) {
+  int step = 1;
+
+  n = 0;
+  for(size_t g = 0; g < groups.size(); g++) {
+    Group &G = groups[g];
+    memset(&G, 0, sizeof(G));
+    for(int l = 0; l < LANES; l++) {
+      // unused lanes run the base configuration and are never reported
+      size_t i = g * LANES + l;
+      PipeConfig c = i < cfgs.size() ? cfgs[i] : PipeConfig();
+      G.aluDist[l] = c.aluDist;
+      G.loadDist[l] = c.loadDist;
+      G.branchPen[l] = c.branchPenalty;
+      G.jumpPen[l] = c.jumpPenalty;
+      G.jrPen[l] = c.jrPenalty;
+      G.perfect[l] = c.predictor == PRED_PERFECT ? -1 : 0;
+      G.bimodal[l] = c.predictor == PRED_BIMODAL ? -1 : 0;
+      for(int b = 0; b < BHT; b++)
+        G.bht[b][l] = 1;   // weakly not taken
+
+      // most cycles one instruction can add
+      int pen = max(c.branchPenalty, max(c.jumpPenalty, c.jrPenalty));
+      step = max(step, 1 + max(c.aluDist, c.loadDist) + pen);
+    }
+  }
+  rebaseEvery = untilRebase = (1L << 30) / step;
+}
+
+// Moves each lane's epoch up to its current cycle.  Ready cycles already
+// passed are clamped to the new epoch, which cannot change any stall.
+void MultiTiming::rebase() {
+  for(size_t g = 0; g < groups.size(); g++) {
+    Group &G = groups[g];
+    for(int l = 0; l < LANES; l++) {
+      int32_t m = G.now[l];
+      for(int r = 0; r < 33; r++)
+        G.ready[r][l] = G.ready[r][l] > m ? G.ready[r][l] - m : 0;
+      G.epoch[l] += m;
+      G.now[l] = 0;
+      G.totalBubbles[l] += G.bubbles[l];
+      G.totalFlushes[l] += G.flushes[l];
+      G.bubbles[l] = G.flushes[l] = 0;
+    }
+  }
+  untilRebase = rebaseEvery;
+}
+
+void MultiTiming::consume(const InstRecord &rec) {
+  // register 0 never causes a hazard and is never written here, so it
+  // also stands in for unused source slots
+  int s0 = rec.src[0] > 0 ? rec.src[0] : 0;
+  int s1 = rec.src[1] > 0 ? rec.src[1] : 0;
+  int d = rec.dest > 0 ? rec.dest : 0;
+  int32_t taken = (rec.flags & REC_TAKEN) ? 1 : 0;
+  int b = (rec.pc >> 2) & (BHT - 1);
+
+  n++;
+  for(size_t g = 0; g < groups.size(); g++) {
+    Group &G = groups[g];
+    int32_t t[LANES];
+
+    for(int l = 0; l < LANES; l++) {
+      int32_t c = G.now[l] + 1;
+      int32_t r = max(G.ready[s0][l], G.ready[s1][l]);
+      int32_t wait = max(r - c, 0);
+      G.bubbles[l] += wait;
+      t[l] = c + wait;
+    }
+    if(d) {
+      const int32_t *dist = (rec.flags & REC_LOAD) ? G.loadDist : G.aluDist;
+      for(int l = 0; l < LANES; l++)
+        G.ready[d][l] = t[l] + dist[l];
+    }
+
+    if(rec.flags & REC_BRANCH) {
+      for(int l = 0; l < LANES; l++) {
+        int32_t ctr = G.bht[b][l];
+        int32_t guess = (G.perfect[l] & taken) | (G.bimodal[l] & (ctr >> 1));
+        int32_t pen = (guess ^ taken) * G.branchPen[l];
+        G.bht[b][l] = min(max(ctr + 2 * taken - 1, 0), 3);
+        G.flushes[l] += pen;
+        t[l] += pen;
+      }
+    }
+    else if(rec.flags & (REC_JUMP | REC_JR)) {
+      const int32_t *penalty = (rec.flags & REC_JUMP) ? G.jumpPen : G.jrPen;
+      for(int l = 0; l < LANES; l++) {
+        G.flushes[l] += penalty[l];
+        t[l] += penalty[l];
+      }
+    }
+
+    for(int l = 0; l < LANES; l++)
+      G.now[l] = t[l];
+  }
+  if(--untilRebase == 0) rebase();
+}
+
+long long MultiTiming::getCycles(int i) const {
+  const Group &G = groups[i / LANES];
+  return G.epoch[i % LANES] + G.now[i % LANES] + cfgs[i].depth - 1;
+}
+
+long long MultiTiming::getBubbles(int i) const {
+  const Group &G = groups[i / LANES];
+  return G.totalBubbles[i % LANES] + G.bubbles[i % LANES];
+}
+
+long long MultiTiming::getFlushes(int i) const {
+  const Group &G = groups[i / LANES];
+  return G.totalFlushes[i % LANES] + G.flushes[i % LANES];
+}
+
+void MultiTiming::printFinalStats() {
+  static const char *preds[] = { "not-taken", "bimodal", "perfect" };
+
+  cout << "Multi-configuration timing: " << cfgs.size() << " configurations in "
+       << groups.size() << " group" << (groups.size() > 1 ? "s" : "") << " of " << LANES << " lanes" << endl;
+  cout << "  " << setw(12) << left << "config" << right << setw(6) << "depth" << setw(5) << "alu"
+       << setw(5) << "load" << setw(11) << "predictor" << setw(14) << "cycles" << setw(8) << "CPI"
+       << setw(14) << "bubbles" << setw(12) << "flushes" << endl;
+  for(size_t i = 0; i < cfgs.size(); i++) {
+    const PipeConfig &c = cfgs[i];
+    cout << "  " << setw(12) << left << c.name << right << setw(6) << c.depth << setw(5) << c.aluDist
+         << setw(5) << c.loadDist << setw(11) << preds[c.predictor] << setw(14) << getCycles(i)
+         << setw(8) << fixed << setprecision(2) << (double)getCycles(i) / n
+         << setw(14) << getBubbles(i) << setw(12) << getFlushes(i) << endl;
+  }
+}
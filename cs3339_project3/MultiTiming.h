@@ -0,0 +1,59 @@
+#ifndef __MULTITIMING_H
+#define __MULTITIMING_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <vector>
+#include "Trace.h"
+#include "PipeConfig.h"
+#include "Debug.h"
+using namespace std;
+
+// Times one instruction stream under many PipeConfigs at once.  The
+// shift-register hazard check of Stats is recast as cycle arithmetic:
+// each register remembers the cycle its last writer's result becomes
+// readable, an instruction leaves ID at the later of the next cycle and
+// its sources' ready cycles, and redirects add their penalty.  That is
+// branch-free per configuration, so configurations are laid out as lanes
+// of structure-of-arrays groups and every per-instruction step is a loop
+// over LANES that the compiler turns into SIMD (AVX2/AVX-512 when built
+// for them, SSE or scalar otherwise).  Lanes keep 32-bit cycle numbers
+// relative to a per-lane epoch that is moved up every so often, which
+// keeps the vectors narrow.  The base PipeConfig gives exactly the Stats
+// cycle, bubble and flush counts.
+class MultiTiming : public TraceSink {
+  public:
+    static const int LANES = 16;
+    static const int BHT = 1024;   // bimodal counters per configuration
+
+    MultiTiming(const vector<PipeConfig> &cfgs);
+
+    void consume(const InstRecord &rec);
+    void printFinalStats();
+
+    long long getCycles(int i) const;
+    long long getBubbles(int i) const;
+    long long getFlushes(int i) const;
+
+  private:
+    struct Group {
+      int32_t now[LANES];          // cycle the current instruction left ID
+      int32_t ready[33][LANES];    // cycle each register becomes readable
+      int32_t bubbles[LANES], flushes[LANES];
+      int32_t aluDist[LANES], loadDist[LANES];
+      int32_t branchPen[LANES], jumpPen[LANES], jrPen[LANES];
+      int32_t perfect[LANES], bimodal[LANES];   // predictor masks, 0 or -1
+      int32_t bht[BHT][LANES];
+      int64_t epoch[LANES], totalBubbles[LANES], totalFlushes[LANES];
+    };
+
+    vector<PipeConfig> cfgs;
+    vector<Group> groups;
+    long long n;
+    long rebaseEvery, untilRebase;   // instructions between epoch moves
+
+    void rebase();
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * Deterministic multicore guest simulation over a shared data memory.
+ */
+
+#include <chrono>
+#include "Multicore.h"
+
+CoreMemory::CoreMemory(Memory &shared, Multicore &owner, int core)
+    : Memory(&shared), direct(false), owner(owner), core(core), reserved(false), resAddr(0) {}
+
+uint32_t CoreMemory::loadWord(uint32_t addr) {
+  if(!direct) {
+    unordered_map<uint32_t, uint32_t>::const_iterator it = stores.find(addr);
+    if(it != stores.end()) return it->second;
+  }
+  return Memory::loadWord(addr);
+}
+
+void CoreMemory::storeWord(uint32_t data, uint32_t addr) {
+  if(wordIndex(addr, true) < 0) return;
+  if(direct) {
+    Memory::storeWord(data, addr);
+    owner.stored(addr, core);
+  }
+  else
+    stores[addr] = data;
+}
+
+uint32_t CoreMemory::loadLinked(uint32_t addr) {
+  uint32_t v = loadWord(addr);
+  reserved = fault == FAULT_NONE;
+  resAddr = addr;
+  return v;
+}
+
+bool CoreMemory::storeConditional(uint32_t data, uint32_t addr) {
+  bool ok = reserved && resAddr == addr;
+  reserved = false;
+  if(ok) storeWord(data, addr);
+  return ok;
+}
+
+void CoreMemory::commit() {
+  for(unordered_map<uint32_t, uint32_t>::const_iterator it = stores.begin(); it != stores.end(); ++it) {
+    Memory::storeWord(it->second, it->first);
+    owner.stored(it->first, core);
+  }
+  stores.clear();
+}
+
+Multicore::Multicore(const Program &prog, const MulticoreConfig &cfg, const Stats &base)
+    : prog(prog), cfg(cfg), instMem(prog.instMemBytes(), TEXT_BASE, false),
+      dataMem(MEMSIZE, DATA_BASE, true) {
+  prog.initInstMem(instMem);
+  for(int c = 0; c < cfg.cores; c++) {
+    instViews.push_back(new CoreInstMemory(instMem));
+    views.push_back(new CoreMemory(dataMem, *this, c));
+    cpus.push_back(new CPU(prog.start, *instViews[c], *views[c]));
+    stats.push_back(new Stats(base));
+    cpus[c]->setStats(*stats[c]);
+    cpus[c]->setCore(c, cfg.cores);
+    cpus[c]->setSyncYield(true);
+    cpus[c]->setReg(29, DATA_BASE + dataMem.getSize() - c * cfg.stackBytes);   // sp
+  }
+  generation = 0;
+  running = 0;
+  quit = false;
+  quanta = syncOps = committed = 0;
+}
+
+Multicore::~Multicore() {
+  for(int c = 0; c < cfg.cores; c++) {
+    delete cpus[c];
+    delete instViews[c];
+    delete views[c];
+    delete stats[c];
+  }
+  for(size_t c = 0; c < ins.size(); c++) {
+    delete ins[c];
+    delete outs[c];
+  }
+}
+
+void Multicore::stored(uint32_t addr, int core) {
+  for(int c = 0; c < cfg.cores; c++)
+    if(c != core) views[c]->breakReservation(addr);
+}
+
+// runs its core for one quantum per generation
+void Multicore::worker(int core) {
+  CPU &cpu = *cpus[core];
+  long long seen = 0;
+
+  for(;;) {
+    {
+      unique_lock<mutex> g(lock);
+      go.wait(g, [this, seen] { return quit || generation != seen; });
+      if(quit) return;
+      seen = generation;
+    }
+    if(!cpu.isStopped() && !cpu.isSyncPending())
+      cpu.run(cpu.getInstructions() + cfg.quantum);
+    {
+      lock_guard<mutex> g(lock);
+      if(--running == 0) idle.notify_one();
+    }
+  }
+}
+
+FAULT Multicore::run(const string &input, ostream &out) {
+  FAULT fault = FAULT_NONE;
+
+  for(int c = 0; c < cfg.cores; c++) {
+    ins.push_back(new istringstream(input));
+    outs.push_back(new ostringstream);
+    cpus[c]->setIO(*ins[c], *outs[c]);
+  }
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for(int c = 0; c < cfg.cores; c++)
+    threads.push_back(thread(&Multicore::worker, this, c));
+
+  for(;;) {
+    bool active = false;
+    for(int c = 0; c < cfg.cores; c++)
+      active = active || !cpus[c]->isStopped();
+    if(!active) break;
+
+    // parallel phase
+    {
+      unique_lock<mutex> g(lock);
+      running = cfg.cores;
+      generation++;
+      go.notify_all();
+      idle.wait(g, [this] { return running == 0; });
+    }
+    quanta++;
+
+    // sync point: stores first, then each waiting sc on its own
+    for(int c = 0; c < cfg.cores; c++) {
+      committed += views[c]->buffered();
+      views[c]->commit();
+    }
+    for(int c = 0; c < cfg.cores && fault == FAULT_NONE; c++) {
+      if(cpus[c]->getFault() != FAULT_NONE) {
+        fault = cpus[c]->getFault();
+        break;
+      }
+      if(cpus[c]->isSyncPending()) {
+        views[c]->direct = true;
+        cpus[c]->grantSync();
+        cpus[c]->run(cpus[c]->getInstructions() + 1);
+        views[c]->direct = false;
+        syncOps++;
+        fault = cpus[c]->getFault();
+      }
+    }
+    if(fault != FAULT_NONE) break;
+  }
+
+  {
+    lock_guard<mutex> g(lock);
+    quit = true;
+  }
+  go.notify_all();
+  for(size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+  chrono::duration<double> host = chrono::steady_clock::now() - t0;
+
+  if(fault == FAULT_NONE)
+    report(out, host.count());
+  return fault;
+}
+
+void Multicore::report(ostream &out, double host) {
+  long long insts = 0, slowest = 0;
+
+  for(int c = 0; c < cfg.cores; c++) {
+    const string &text = outs[c]->str();
+    if(text.empty()) continue;
+    out << "core " << c << " output:" << text;
+    if(text[text.size() - 1] != '\n') out << endl;
+  }
+
+  out << endl << "Multicore: " << cfg.cores << " cores, quantum " << cfg.quantum << " instructions, "
+      << quanta << " quanta, " << syncOps << " sc sync points, " << committed << " stores committed" << endl;
+  for(int c = 0; c < cfg.cores; c++) {
+    long long n = cpus[c]->getInstructions(), cycles = stats[c]->getCycles();
+    out << "  core " << c << ": " << n << " instructions, " << cycles << " cycles, CPI "
+        << fixed << setprecision(2) << (n ? (double)cycles / n : 0.0) << endl;
+    insts += n;
+    slowest = max(slowest, cycles);
+  }
+  out << "  total " << insts << " instructions, " << slowest << " cycles on the slowest core, "
+      << setprecision(2) << host << " s host time" << endl;
+}
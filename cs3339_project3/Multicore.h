@@ -0,0 +1,108 @@
+#ifndef __MULTICORE_H
+#define __MULTICORE_H
+
+#include <iostream>
+#include <sstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Program.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct MulticoreConfig {
+  int cores;
+  long quantum;       // instructions per core between sync points
+  int stackBytes;     // stack carved off the top of data memory per core
+
+  MulticoreConfig() : cores(2), quantum(1000), stackBytes(16 << 10) {}
+};
+
+class Multicore;
+
+// One core's view of the shared instruction memory, so that a fetch fault
+// is recorded against the core that took it and not raced on by all.
+class CoreInstMemory : public Memory {
+  public:
+    CoreInstMemory(const Memory &shared) : Memory(&shared) {}
+};
+
+// One core's window onto the shared data memory.  Within a quantum loads
+// see shared memory as it was at the last sync point plus this core's own
+// stores, which are buffered; the host commits the buffers in core order
+// at the sync point.  ll takes a reservation that any committed store to
+// the word breaks; sc always waits for the sync point (see CPU) and then
+// runs alone, writing through.
+class CoreMemory : public Memory {
+  public:
+    CoreMemory(Memory &shared, Multicore &owner, int core);
+
+    uint32_t loadWord(uint32_t addr);
+    void storeWord(uint32_t data, uint32_t addr);
+    uint32_t loadLinked(uint32_t addr);
+    bool storeConditional(uint32_t data, uint32_t addr);
+
+    void commit();                     // publish the buffered stores
+    void breakReservation(uint32_t addr) { if(reserved && resAddr == addr) reserved = false; }
+    size_t buffered() const { return stores.size(); }
+
+    bool direct;                       // write through, while running sc
+
+  private:
+    Multicore &owner;
+    int core;
+    unordered_map<uint32_t, uint32_t> stores;
+    bool reserved;
+    uint32_t resAddr;
+};
+
+// N guest cores on N host threads sharing one data memory.  Each core has
+// its own registers, pc, Stats and trap I/O (a copy of the input, output
+// kept and printed per core at the end).  Cores run quantum instructions
+// in parallel, then meet: stores are committed in core order and pending
+// sc instructions run in core order.  Nothing a core sees depends on host
+// thread timing, so runs are deterministic.
+class Multicore {
+  public:
+    Multicore(const Program &prog, const MulticoreConfig &cfg, const Stats &base);
+    ~Multicore();
+
+    FAULT run(const string &input, ostream &out);
+
+    // a committed store to addr breaks every other core's reservation on it
+    void stored(uint32_t addr, int core);
+
+  private:
+    const Program &prog;
+    MulticoreConfig cfg;
+
+    Memory instMem, dataMem;
+    vector<CoreInstMemory *> instViews;
+    vector<CoreMemory *> views;
+    vector<CPU *> cpus;
+    vector<Stats *> stats;
+    vector<istringstream *> ins;
+    vector<ostringstream *> outs;
+
+    // host threads
+    vector<thread> threads;
+    mutex lock;
+    condition_variable go, idle;
+    long long generation;
+    int running;
+    bool quit;
+
+    long long quanta, syncOps, committed;
+
+    void worker(int core);
+    void report(ostream &out, double host);
+};
+
+#endif
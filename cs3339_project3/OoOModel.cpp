@@ -0,0 +1,141 @@
+/*
+ * Out-of-order core timing model.  See OoOModel.h for the scheduling
+ * scheme; all times are absolute cycle numbers.
+ */
+
+#include <algorithm>
+#include "OoOModel.h"
+#include "ALU.h"
+#include "Stats.h"
+
+OoOModel::OoOModel(const OoOConfig &cfg) : cfg(cfg), robCommit(cfg.robSize, 0),
+    lsqCommit(cfg.lsqSize, 0), slots(SLOTS) {
+  for(int i = 0; i < 33; i++)
+    regReady[i] = 0;
+  for(int i = 0; i < SLOTS; i++)
+    slots[i].cycle = -1;
+  for(int i = 0; i < STQ; i++) {
+    storeReady[i] = 0;
+    storeAddr[i] = 0;
+  }
+  n = memN = 0;
+  fetchReady = 0;
+  lastDispatch = lastCommit = 0;
+  dispatchCount = commitCount = 0;
+  divBusy = 0;
+  robStalls = iqStalls = lsqStalls = redirectStalls = 0;
+}
+
+OoOModel::IssueSlot &OoOModel::slot(long long cycle) {
+  IssueSlot &s = slots[cycle & (SLOTS - 1)];
+  if(s.cycle != cycle) {
+    s.cycle = cycle;
+    s.total = s.mem = s.mul = 0;
+  }
+  return s;
+}
+
+void OoOModel::consume(const InstRecord &rec) {
+  bool isMem = rec.flags & (REC_LOAD | REC_STORE);
+  bool isMul = rec.aluOp == MUL, isDiv = rec.aluOp == DIV;
+
+  // dispatch: in order, width per cycle
+  long long d = lastDispatch;
+  if(dispatchCount == cfg.width) d++;
+  if(fetchReady > d) {
+    redirectStalls += fetchReady - d;
+    d = fetchReady;
+  }
+  long long robFree = robCommit[n % cfg.robSize];
+  if(robFree > d) {
+    robStalls += robFree - d;
+    d = robFree;
+  }
+  while(!iq.empty() && iq.top() <= d)
+    iq.pop();
+  if((int)iq.size() >= cfg.iqSize) {
+    long long iqFree = iq.top();
+    iqStalls += iqFree - d;
+    d = iqFree;
+    while(!iq.empty() && iq.top() <= d)
+      iq.pop();
+  }
+  if(isMem) {
+    long long lsqFree = lsqCommit[memN % cfg.lsqSize];
+    if(lsqFree > d) {
+      lsqStalls += lsqFree - d;
+      d = lsqFree;
+    }
+  }
+  if(d != lastDispatch) dispatchCount = 0;
+  lastDispatch = d;
+  dispatchCount++;
+
+  // issue: operands ready and a free slot of the right kind
+  long long ready = d + 1;
+  for(int s = 0; s < 2; s++)
+    if(rec.src[s] > 0)
+      ready = max(ready, regReady[rec.src[s]]);
+  int st = (rec.memAddr >> 2) & (STQ - 1);
+  if((rec.flags & REC_LOAD) && storeAddr[st] == rec.memAddr)
+    ready = max(ready, storeReady[st]);
+  if(isDiv)
+    ready = max(ready, divBusy);
+
+  long long issue = ready;
+  for(;; issue++) {
+    IssueSlot &s = slot(issue);
+    if(s.total >= cfg.width) continue;
+    if(isMem && s.mem >= cfg.memPorts) continue;
+    if(isMul && s.mul >= 1) continue;
+    s.total++;
+    if(isMem) s.mem++;
+    if(isMul) s.mul++;
+    break;
+  }
+  iq.push(issue);
+
+  int lat = cfg.aluLat;
+  if(rec.flags & REC_LOAD) lat = cfg.loadLat;
+  else if(isMul) lat = cfg.mulLat;
+  else if(isDiv) lat = cfg.divLat;
+  long long complete = issue + lat;
+  if(isDiv) divBusy = complete;   // unpipelined
+
+  if(rec.dest > 0)
+    regReady[rec.dest] = complete;
+  if(rec.flags & REC_STORE) {
+    storeAddr[st] = rec.memAddr;
+    storeReady[st] = complete;
+  }
+
+  // commit: in order, width per cycle
+  long long c = max(complete, lastCommit);
+  if(c == lastCommit && commitCount == cfg.width) c++;
+  if(c != lastCommit) commitCount = 0;
+  lastCommit = c;
+  commitCount++;
+  robCommit[n % cfg.robSize] = c;
+  if(isMem)
+    lsqCommit[memN++ % cfg.lsqSize] = c;
+
+  // front-end redirects (predict not taken)
+  if(rec.flags & REC_JUMP)
+    fetchReady = d + 1 + FRONTEND;
+  else if(rec.flags & (REC_TAKEN | REC_JR))
+    fetchReady = complete + FRONTEND;
+
+  n++;
+}
+
+void OoOModel::printFinalStats() {
+  long long cycles = lastCommit + FRONTEND + 1;   // fill from IF1 to the first dispatch
+  cout << "Out-of-order model: width " << cfg.width << ", ROB " << cfg.robSize << ", IQ "
+       << cfg.iqSize << ", LSQ " << cfg.lsqSize << ", " << cfg.memPorts << " mem ports" << endl;
+  cout << "  Cycles: " << cycles << endl;
+  cout << "  CPI: " << fixed << setprecision(2) << (double)cycles / n << endl;
+  cout << "  ROB-full stall cycles: " << robStalls << endl;
+  cout << "  IQ-full stall cycles: " << iqStalls << endl;
+  cout << "  LSQ-full stall cycles: " << lsqStalls << endl;
+  cout << "  Fetch redirect cycles: " << redirectStalls << endl;
+}
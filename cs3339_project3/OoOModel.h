@@ -0,0 +1,75 @@
+#ifndef __OOOMODEL_H
+#define __OOOMODEL_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include "Trace.h"
+#include "Debug.h"
+using namespace std;
+
+struct OoOConfig {
+  int width;       // fetch/dispatch/issue/commit width
+  int robSize;
+  int iqSize;
+  int lsqSize;
+  int memPorts;    // loads/stores issued per cycle
+  int aluLat, loadLat, mulLat, divLat;
+
+  OoOConfig() : width(4), robSize(128), iqSize(32), lsqSize(32), memPorts(2),
+                aluLat(1), loadLat(3), mulLat(4), divLat(12) {}
+};
+
+// Out-of-order timing model driven by the same InstRecord stream as Stats.
+// Rather than stepping cycle by cycle it schedules each instruction once,
+// in program order, against the resources it needs:
+//   dispatch - in order, width per cycle, needs a free ROB, issue queue
+//              and (for memory ops) LSQ entry
+//   issue    - once sources are ready (renaming leaves only RAW
+//              dependences), width per cycle, subject to FU availability
+//   commit   - in order, width per cycle, after completion
+// Branches are predicted not taken: a taken branch or jr refetches after
+// it executes, j/jal after decode.  Work per instruction is O(log iqSize).
+class OoOModel : public TraceSink {
+  public:
+    OoOModel(const OoOConfig &cfg);
+
+    void consume(const InstRecord &rec);
+    void printFinalStats();
+
+    long long getCycles() const { return lastCommit; }
+
+  private:
+    static const int FRONTEND = 2;       // IF1, IF2 ahead of dispatch
+    static const int SLOTS = 1 << 14;    // issue bookkeeping window (cycles)
+    static const int STQ = 1024;         // store-to-load forwarding table
+
+    struct IssueSlot {
+      long long cycle;
+      uint8_t total, mem, mul;
+    };
+
+    OoOConfig cfg;
+
+    long long regReady[33];
+    vector<long long> robCommit;         // commit cycle of the last robSize instrs
+    vector<long long> lsqCommit;         // same for the last lsqSize memory ops
+    priority_queue<long long, vector<long long>, greater<long long> > iq; // issue cycles
+    vector<IssueSlot> slots;
+    long long storeReady[STQ];
+    uint32_t storeAddr[STQ];
+
+    long long n, memN;
+    long long fetchReady;                // earliest dispatch after a redirect
+    long long lastDispatch, lastCommit;
+    int dispatchCount, commitCount;
+    long long divBusy;
+
+    long long robStalls, iqStalls, lsqStalls, redirectStalls;
+
+    IssueSlot &slot(long long cycle);
+};
+
+#endif
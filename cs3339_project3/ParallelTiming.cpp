@@ -0,0 +1,145 @@
+/*
+ * Exact parallel timing of the in-order pipeline by speculative chunking.
+ */
+
+#include <thread>
+#include "ParallelTiming.h"
+
+static void diffCounters(const StatsCounters &after, const StatsCounters &before, StatsCounters &d) {
+  d.cycles = after.cycles - before.cycles;
+  d.bubbles = after.bubbles - before.bubbles;
+  d.flushes = after.flushes - before.flushes;
+  d.memops = after.memops - before.memops;
+  d.branches = after.branches - before.branches;
+  d.taken = after.taken - before.taken;
+  for(int i = 0; i < STALL_CAUSES; i++)
+    d.stalls[i] = after.stalls[i] - before.stalls[i];
+}
+
+static void addTo(StatsCounters &sum, const StatsCounters &d) {
+  sum.cycles += d.cycles;
+  sum.bubbles += d.bubbles;
+  sum.flushes += d.flushes;
+  sum.memops += d.memops;
+  sum.branches += d.branches;
+  sum.taken += d.taken;
+  for(int i = 0; i < STALL_CAUSES; i++)
+    sum.stalls[i] += d.stalls[i];
+}
+
+ParallelTiming::ParallelTiming(Stats &model, const ParallelTimingConfig &cfg)
+    : model(model), cfg(cfg) {
+  window.reserve(cfg.threads * cfg.chunk);
+  windows = mispredicted = fixupInsts = unconverged = 0;
+}
+
+void ParallelTiming::consume(const InstRecord &rec) {
+  window.push_back(rec);
+  if(window.size() == (size_t)cfg.threads * cfg.chunk)
+    runWindow();
+}
+
+void ParallelTiming::finish() {
+  if(!window.empty()) runWindow();
+}
+
+// runs on a worker thread; local models start as copies of the idle model
+void ParallelTiming::timeChunk(Chunk &c) {
+  Stats local(model);
+  StatsCounters before, after;
+
+  if(c.begin > 0) {
+    // warm an empty pipeline on the tail of the previous chunk
+    size_t from = c.begin > (size_t)cfg.warm ? c.begin - cfg.warm : 0;
+    local.setPipeState(0);
+    for(size_t i = from; i < c.begin; i++)
+      local.process(window[i]);
+    c.guess = local.getPipeState();
+  }
+  local.setPipeState(c.guess);
+  local.getCounters(before);
+  for(size_t i = c.begin; i < c.end; i++)
+    local.process(window[i]);
+  local.getCounters(after);
+  diffCounters(after, before, c.delta);
+  c.exit = local.getPipeState();
+}
+
+// Re-times c from the true entry state alongside the guessed one until
+// both models hold the same state; from there on the speculative timing
+// is exact, so only the difference accumulated so far is applied.
+void ParallelTiming::fixup(Chunk &c, uint64_t entry) {
+  Stats good(model), spec(model);
+  StatsCounters g0, s0, g1, s1, dg, ds;
+  size_t i;
+
+  mispredicted++;
+  good.setPipeState(entry);
+  spec.setPipeState(c.guess);
+  good.getCounters(g0);
+  spec.getCounters(s0);
+  for(i = c.begin; i < c.end; i++) {
+    good.process(window[i]);
+    spec.process(window[i]);
+    if(good.getPipeState() == spec.getPipeState()) break;
+  }
+  fixupInsts += (i < c.end ? i + 1 : i) - c.begin;
+  good.getCounters(g1);
+  spec.getCounters(s1);
+  diffCounters(g1, g0, dg);
+  diffCounters(s1, s0, ds);
+
+  if(i == c.end) {
+    // never converged: the re-timed run covered the whole chunk
+    unconverged++;
+    c.delta = dg;
+    c.exit = good.getPipeState();
+  }
+  else {
+    c.delta.cycles += dg.cycles - ds.cycles;
+    c.delta.bubbles += dg.bubbles - ds.bubbles;
+    c.delta.flushes += dg.flushes - ds.flushes;
+    for(int k = 0; k < STALL_CAUSES; k++)
+      c.delta.stalls[k] += dg.stalls[k] - ds.stalls[k];
+  }
+}
+
+void ParallelTiming::runWindow() {
+  vector<thread> workers;
+  StatsCounters sum = StatsCounters();
+  uint64_t state = model.getPipeState();
+
+  chunks.clear();
+  for(size_t b = 0; b < window.size(); b += cfg.chunk) {
+    Chunk c;
+    c.begin = b;
+    c.end = b + cfg.chunk < window.size() ? b + cfg.chunk : window.size();
+    c.guess = state;
+    chunks.push_back(c);
+  }
+
+  for(size_t k = 1; k < chunks.size(); k++)
+    workers.push_back(thread(&ParallelTiming::timeChunk, this, ref(chunks[k])));
+  timeChunk(chunks[0]);
+  for(size_t k = 0; k < workers.size(); k++)
+    workers[k].join();
+
+  // sequential scan: chain the exit states, repairing wrong guesses
+  for(size_t k = 0; k < chunks.size(); k++) {
+    if(chunks[k].guess != state) fixup(chunks[k], state);
+    addTo(sum, chunks[k].delta);
+    state = chunks[k].exit;
+  }
+  model.addCounters(sum);
+  model.setPipeState(state);
+
+  windows++;
+  window.clear();
+}
+
+void ParallelTiming::printFinalStats() {
+  cout << "Parallel timing: " << cfg.threads << " threads, " << windows << " windows, "
+       << mispredicted << " entry states repaired (" << fixupInsts << " instructions re-timed";
+  if(unconverged) cout << ", " << unconverged << " chunks fully";
+  cout << ")" << endl;
+}
@@ -0,0 +1,60 @@
+#ifndef __PARALLELTIMING_H
+#define __PARALLELTIMING_H
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct ParallelTimingConfig {
+  int threads;   // chunks timed at once
+  long chunk;    // instructions per chunk
+  int warm;      // instructions of the previous chunk used to guess the entry state
+
+  ParallelTimingConfig() : threads(4), chunk(1 << 18), warm(4 * PIPESTAGES) {}
+};
+
+// Exact parallel timing of the Stats pipeline.  Between instructions the
+// model is fully described by its packed pipeline state (getPipeState),
+// so a chunk of trace is a function from entry state to exit state plus
+// counter deltas, and timing a trace is a scan over those functions.
+// Records are buffered into windows of threads * chunk instructions.
+// Every chunk is timed on its own thread from a guessed entry state: the
+// true one for the first chunk, otherwise the state left by timing the
+// tail of the previous chunk from an empty pipeline.  A sequential fix-up
+// then walks the chunks in order; where the guess was wrong, the chunk is
+// re-timed from the true state in lockstep with the guess until the two
+// states meet, and only the counter difference up to that point is added.
+// The hazard state reaches back a handful of instructions, so the fix-up
+// is short and the totals match sequential timing exactly.
+class ParallelTiming : public TraceSink {
+  public:
+    ParallelTiming(Stats &model, const ParallelTimingConfig &cfg);
+
+    void consume(const InstRecord &rec);
+    void finish();   // time the partial last window
+    void printFinalStats();
+
+  private:
+    struct Chunk {
+      size_t begin, end;
+      uint64_t guess, exit;   // entry state assumed, exit state reached
+      StatsCounters delta;
+    };
+
+    Stats &model;
+    ParallelTimingConfig cfg;
+    vector<InstRecord> window;
+    vector<Chunk> chunks;
+
+    long long windows, mispredicted, fixupInsts, unconverged;
+
+    void runWindow();
+    void timeChunk(Chunk &c);
+    void fixup(Chunk &c, uint64_t entry);
+};
+
+#endif
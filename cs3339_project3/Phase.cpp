@@ -0,0 +1,176 @@
+/*
+ * Online phase classification that skips detailed timing of recurring,
+ * stable phases.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "Phase.h"
+#include "CPU.h"
+#include "Memory.h"
+
+bool PhaseSim::Phase::stable(const PhaseConfig &cfg) const {
+  return samples >= cfg.minSamples && cpiSD() <= cfg.stableCV * sumCpi / samples;
+}
+
+double PhaseSim::Phase::cpiSD() const {
+  if(samples < 2) return 0.0;
+  double mean = sumCpi / samples;
+  double var = (sumCpi2 - samples * mean * mean) / (samples - 1);
+  return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+PhaseSim::PhaseSim(const Program &prog, const Stats &base, const PhaseConfig &cfg)
+    : prog(prog), cfg(cfg), timing(base), full(base) {
+  memset(sig, 0, sizeof(sig));
+  blockEnded = true;
+  pos = 0;
+  detailed = true;
+  predicted = -1;
+  c0 = b0 = f0 = 0;
+  n = memops = branches = taken = 0;
+  detailedInsts = skippedIntervals = mispredicts = 0;
+  cycles = PIPESTAGES - 1;
+  bubbles = flushes = errorBound = 0.0;
+}
+
+FAULT PhaseSim::run(istream &in, ostream &out) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  CPU cpu(prog.start, instMem, dataMem);
+
+  prog.initInstMem(instMem);
+  cpu.setIO(in, out);
+  cpu.setTraceSink(this);
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  if(cpu.run() != FAULT_NONE)
+    return cpu.getFault();
+  if(pos > 0)
+    endInterval();
+  chrono::duration<double> host = chrono::steady_clock::now() - t0;
+
+  report(host.count());
+  return FAULT_NONE;
+}
+
+void PhaseSim::consume(const InstRecord &rec) {
+  if(blockEnded) {
+    uint32_t h = (rec.pc >> 2) * 2654435761u;
+    int bit = h >> (32 - 10);   // SIG_BITS == 1 << 10
+    sig[bit >> 6] |= 1ULL << (bit & 63);
+  }
+  blockEnded = rec.flags & (REC_BRANCH | REC_JUMP | REC_JR);
+
+  if(rec.flags & (REC_LOAD | REC_STORE)) memops++;
+  if(rec.flags & REC_BRANCH) branches++;
+  if(rec.flags & REC_TAKEN) taken++;
+  if(cfg.verify) full.process(rec);
+
+  if(pos == 0) {
+    c0 = timing.getCycles();
+    b0 = timing.getBubbles();
+    f0 = timing.getFlushes();
+  }
+  if(detailed) {
+    timing.process(rec);
+    detailedInsts++;
+  }
+  else if(pos >= cfg.interval - WARM)
+    timing.process(rec);   // rebuild pipeline state in case the next interval is detailed
+
+  n++;
+  if(++pos == cfg.interval)
+    endInterval();
+}
+
+// closest known phase, or a new one if none is within the threshold
+int PhaseSim::classify() {
+  int best = -1;
+  double bestDist = 2.0;
+
+  for(size_t p = 0; p < phases.size(); p++) {
+    int diff = 0, uni = 0;
+    for(int w = 0; w < SIG_WORDS; w++) {
+      diff += __builtin_popcountll(sig[w] ^ phases[p].sig[w]);
+      uni += __builtin_popcountll(sig[w] | phases[p].sig[w]);
+    }
+    double d = uni ? (double)diff / uni : 0.0;
+    if(d < bestDist) {
+      bestDist = d;
+      best = p;
+    }
+  }
+  if(best >= 0 && bestDist <= cfg.threshold)
+    return best;
+
+  Phase ph;
+  memcpy(ph.sig, sig, sizeof(sig));
+  ph.samples = 0;
+  ph.sumCpi = ph.sumCpi2 = ph.sumBpi = ph.sumFpi = 0.0;
+  ph.intervals = 0;
+  phases.push_back(ph);
+  return phases.size() - 1;
+}
+
+void PhaseSim::endInterval() {
+  int p = classify();
+  Phase &ph = phases[p];
+  ph.intervals++;
+
+  if(detailed) {
+    double dc = timing.getCycles() - c0, db = timing.getBubbles() - b0, df = timing.getFlushes() - f0;
+    cycles += dc;
+    bubbles += db;
+    flushes += df;
+    ph.samples++;
+    ph.sumCpi += dc / pos;
+    ph.sumCpi2 += (dc / pos) * (dc / pos);
+    ph.sumBpi += db / pos;
+    ph.sumFpi += df / pos;
+  }
+  else {
+    // extrapolate from the phase the interval turned out to be in, or
+    // from the predicted one if that phase has never been timed
+    const Phase &src = ph.samples > 0 ? ph : phases[predicted];
+    if(p != predicted) mispredicts++;
+    cycles += pos * src.sumCpi / src.samples;
+    bubbles += pos * src.sumBpi / src.samples;
+    flushes += pos * src.sumFpi / src.samples;
+    errorBound += pos * src.cpiSD();
+    skippedIntervals++;
+  }
+
+  // last-phase prediction decides how the next interval is run
+  predicted = p;
+  detailed = !ph.stable(cfg);
+  memset(sig, 0, sizeof(sig));
+  pos = 0;
+}
+
+void PhaseSim::report(double seconds) {
+  cout << endl << "Phase detection: " << phases.size() << " phases, intervals of " << cfg.interval
+       << " instructions, " << skippedIntervals << " extrapolated (" << mispredicts
+       << " phase mispredictions)" << endl;
+
+  cout << endl << "Program finished (" << dec << n << " instructions executed, "
+       << detailedInsts << " timed in detail)" << endl;
+  RunSummary s;
+  s.instructions = n;
+  s.cycles = cycles;
+  s.cpi = cycles / n;
+  s.bubbles = bubbles;
+  s.flushes = flushes;
+  s.memops = memops;
+  s.branches = branches;
+  s.taken = taken;
+  printRunSummary(s);
+  cout << "Timing work skipped: " << setprecision(1) << 100.0 * (n - detailedInsts) / n
+       << "% (" << setprecision(2) << (detailedInsts ? (double)n / detailedInsts : 0.0)
+       << "x fewer timed instructions), host time " << setprecision(2) << seconds << "s" << endl;
+  cout << "Estimated cycle error: +/- " << setprecision(2) << 100.0 * errorBound / cycles << "%" << endl;
+
+  if(cfg.verify)
+    printEstimateError(cycles, bubbles, flushes, full);
+}
@@ -0,0 +1,72 @@
+#ifndef __PHASE_H
+#define __PHASE_H
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include "Program.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct PhaseConfig {
+  long interval;       // instructions per classification interval
+  double threshold;    // max relative signature distance within one phase
+  int minSamples;      // detailed intervals before a phase may be skipped
+  double stableCV;     // max coefficient of variation of a phase's CPI
+  bool verify;         // also time the whole run and report the true error
+
+  PhaseConfig() : interval(10000), threshold(0.3), minSamples(3), stableCV(0.02), verify(false) {}
+};
+
+// Online phase detection with timing reuse.  Each interval gets a
+// working-set signature (a bit per hashed basic-block leader).  Intervals
+// whose signature is close to a known phase belong to it.  While the
+// current phase has a stable, well-sampled CPI the next interval is run
+// functionally and its timing extrapolated from the phase; whenever the
+// signature no longer matches, the following interval is timed in detail.
+class PhaseSim : public TraceSink {
+  public:
+    static const int SIG_BITS = 1024;
+    static const int SIG_WORDS = SIG_BITS / 64;
+    static const int WARM = 2 * PIPESTAGES;  // detailed warmup before a detailed interval
+
+    PhaseSim(const Program &prog, const Stats &base, const PhaseConfig &cfg);
+
+    FAULT run(istream &in, ostream &out);   // guest fault, if one stopped the run
+    void consume(const InstRecord &rec);
+
+  private:
+    struct Phase {
+      uint64_t sig[SIG_WORDS];
+      int samples;
+      double sumCpi, sumCpi2, sumBpi, sumFpi;
+      long long intervals;
+
+      bool stable(const PhaseConfig &cfg) const;
+      double cpiSD() const;
+    };
+
+    const Program &prog;
+    PhaseConfig cfg;
+
+    Stats timing, full;
+    vector<Phase> phases;
+    uint64_t sig[SIG_WORDS];
+    bool blockEnded;
+    long pos;                 // position within the interval
+    bool detailed;            // current interval timed in detail
+    int predicted;            // phase the current interval is expected to be in
+    long long c0, b0, f0;
+
+    long long n, memops, branches, taken;
+    long long detailedInsts, skippedIntervals, mispredicts;
+    double cycles, bubbles, flushes, errorBound;
+
+    void endInterval();
+    int classify();
+    void report(double seconds);
+};
+
+#endif
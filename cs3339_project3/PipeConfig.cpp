@@ -0,0 +1,109 @@
+/*
+ * Reader for the pipeline configuration files used by design sweeps.
+ * Only the subset of JSON the files need is accepted: one array of
+ * objects whose values are strings or integers.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include "PipeConfig.h"
+
+namespace {
+
+struct Parser {
+  const string &s;
+  size_t p;
+
+  Parser(const string &s) : s(s), p(0) {}
+
+  void skip() { while(p < s.size() && isspace((unsigned char)s[p])) p++; }
+  bool eat(char c) {
+    skip();
+    if(p < s.size() && s[p] == c) { p++; return true; }
+    return false;
+  }
+  bool str(string &out) {
+    if(!eat('"')) return false;
+    size_t e = s.find('"', p);
+    if(e == string::npos) return false;
+    out = s.substr(p, e - p);
+    p = e + 1;
+    return true;
+  }
+  bool num(int &out) {
+    skip();
+    const char *b = s.c_str() + p;
+    char *e;
+    long v = strtol(b, &e, 10);
+    if(e == b) return false;
+    p += e - b;
+    out = (int)v;
+    return true;
+  }
+};
+
+bool setKey(PipeConfig &c, const string &key, Parser &in) {
+  string v;
+  int *field = NULL;
+
+  if(key == "name") return in.str(c.name);
+  if(key == "predictor") {
+    if(!in.str(v)) return false;
+    if(v == "not-taken") c.predictor = PRED_NOT_TAKEN;
+    else if(v == "bimodal") c.predictor = PRED_BIMODAL;
+    else if(v == "perfect") c.predictor = PRED_PERFECT;
+    else return false;
+    return true;
+  }
+  if(key == "depth") field = &c.depth;
+  else if(key == "alu") field = &c.aluDist;
+  else if(key == "load") field = &c.loadDist;
+  else if(key == "branch") field = &c.branchPenalty;
+  else if(key == "jump") field = &c.jumpPenalty;
+  else if(key == "jr") field = &c.jrPenalty;
+  if(!field || !in.num(*field) || *field < 0) return false;
+  return (field != &c.aluDist && field != &c.loadDist) || *field <= MAX_RESULT_DIST;
+}
+
+}
+
+bool loadPipeConfigs(const char *file, vector<PipeConfig> &cfgs) {
+  ifstream f(file);
+  if(!f) {
+    cerr << "Could not open " << file << endl;
+    return false;
+  }
+  stringstream buf;
+  buf << f.rdbuf();
+  string text = buf.str();
+  Parser in(text);
+
+  if(!in.eat('[')) goto bad;
+  if(!in.eat(']')) {
+    do {
+      PipeConfig c;
+      if(!in.eat('{')) goto bad;
+      if(!in.eat('}')) {
+        do {
+          string key;
+          if(!in.str(key) || !in.eat(':') || !setKey(c, key, in)) goto bad;
+        } while(in.eat(','));
+        if(!in.eat('}')) goto bad;
+      }
+      if(c.depth < 2) goto bad;
+      cfgs.push_back(c);
+    } while(in.eat(','));
+    if(!in.eat(']')) goto bad;
+  }
+  if(cfgs.empty()) {
+    cerr << file << ": no configurations" << endl;
+    return false;
+  }
+  return true;
+
+bad:
+  cerr << file << ": bad configuration near offset " << in.p << endl;
+  return false;
+}
@@ -0,0 +1,37 @@
+#ifndef __PIPECONFIG_H
+#define __PIPECONFIG_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Debug.h"
+using namespace std;
+
+enum PREDICTOR { PRED_NOT_TAKEN, PRED_BIMODAL, PRED_PERFECT };
+
+const int MAX_RESULT_DIST = 31;   // longest alu/load distance a config may ask for
+
+// One point in an in-order pipeline design space.  Result distances are
+// the cycles from a producer leaving ID to the first cycle a consumer may
+// leave ID: 5 is the Stats pipeline (no forwarding, read after WB), 1 is
+// full forwarding into the next instruction.  The defaults reproduce Stats.
+struct PipeConfig {
+  string name;
+  int depth;        // pipeline stages, only the fill cost depends on it
+  int aluDist;      // result distance of ALU and hi/lo results
+  int loadDist;     // result distance of loads
+  int branchPenalty, jumpPenalty, jrPenalty;   // cycles flushed on a redirect
+  PREDICTOR predictor;                         // conditional branches only
+
+  PipeConfig() : name("base"), depth(8), aluDist(5), loadDist(5),
+                 branchPenalty(2), jumpPenalty(2), jrPenalty(2), predictor(PRED_NOT_TAKEN) {}
+};
+
+// Reads a JSON array of flat objects, e.g.
+//   [ { "name": "fwd", "alu": 1, "load": 2, "predictor": "bimodal" } ]
+// Keys: name, depth, alu, load, branch, jump, jr, predictor
+// (not-taken, bimodal, perfect); missing keys keep the defaults.  Result
+// distances above MAX_RESULT_DIST are rejected.
+bool loadPipeConfigs(const char *file, vector<PipeConfig> &cfgs);
+
+#endif
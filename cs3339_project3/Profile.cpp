@@ -0,0 +1,51 @@
+/*
+ * Per-PC stall and flush attribution.  Stats fills the counters; this file
+ * only formats them.
+ */
+
+#include <algorithm>
+#include "Profile.h"
+
+PCProfile::PCProfile(int instWords) : count(instWords, 0), consumerBubbles(instWords, 0),
+    producerBubbles(instWords, 0), flushes(instWords, 0) {
+}
+
+// Instructions sorted by the cycles they cost, either waiting or being
+// waited on, and by flushes.
+void PCProfile::printReport(int top) {
+  vector<int> order;
+  for(size_t i = 0; i < count.size(); i++)
+    if(count[i] > 0)
+      order.push_back(i);
+  sort(order.begin(), order.end(), [this](int a, int b) {
+    long long ca = consumerBubbles[a] + producerBubbles[a] + flushes[a];
+    long long cb = consumerBubbles[b] + producerBubbles[b] + flushes[b];
+    return ca != cb ? ca > cb : a < b;
+  });
+
+  cout << "Per-PC profile (top " << min((size_t)top, order.size()) << " of "
+       << order.size() << " executed instructions):" << endl;
+  cout << "          pc         count   cons bubbles   prod bubbles        flushes" << endl;
+  for(size_t i = 0; i < order.size() && (int)i < top; i++) {
+    int x = order[i];
+    cout << "  0x" << hex << setfill('0') << setw(8) << address(x) << dec << setfill(' ')
+         << setw(14) << count[x] << setw(15) << consumerBubbles[x]
+         << setw(15) << producerBubbles[x] << setw(15) << flushes[x] << endl;
+  }
+}
+
+bool PCProfile::writeCSV(const char *fileName) {
+  ofstream out(fileName);
+  if(!out) {
+    cerr << "error: could not write profile " << fileName << endl;
+    return false;
+  }
+
+  out << "pc,count,consumer_bubbles,producer_bubbles,flushes" << endl;
+  for(size_t i = 0; i < count.size(); i++) {
+    if(count[i] == 0) continue;
+    out << "0x" << hex << address(i) << dec << "," << count[i] << "," << consumerBubbles[i]
+        << "," << producerBubbles[i] << "," << flushes[i] << endl;
+  }
+  return true;
+}
@@ -0,0 +1,33 @@
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+#include "Debug.h"
+using namespace std;
+
+// Per-static-instruction timing profile.  Counters are flat arrays over
+// all of instruction memory (not just the text, which a runaway program
+// can run past) indexed by (pc - TEXT_BASE) >> 2 so the hot path is a few
+// array increments.
+class PCProfile {
+  public:
+    vector<long long> count;            // times executed
+    vector<long long> consumerBubbles;  // bubbles while this instruction waited in ID
+    vector<long long> producerBubbles;  // bubbles others spent waiting for its result
+    vector<long long> flushes;          // fetch slots flushed behind it
+
+    PCProfile(int instWords);
+
+    static int index(uint32_t pc) { return (pc - TEXT_BASE) >> 2; }
+    static uint32_t address(int index) { return TEXT_BASE + (index << 2); }
+
+    void printReport(int top);
+    bool writeCSV(const char *fileName);
+};
+
+#endif
@@ -0,0 +1,65 @@
+/******************************
+ * Copyright 2021, Lee B. Hinkle, all rights reserved
+ * Based on prior work by Martin Burtscher and Molly O'Neil
+ * Redistribution in source or binary form, with or without modification,
+ * is *not* permitted. Use in source or binary form, with or without
+ * modification, is only permitted for academic use in CS 3339 at
+ * Texas State University.
+ *******************************/
+#include "Program.h"
+
+bool Program::load(const char *fileName) {
+  ifstream exeFile;
+  uint8_t bytes[4];
+  int count;
+
+  name = fileName;
+
+  // open executable
+  exeFile.open(fileName, ios::binary | ios::in);
+  if(!exeFile) {
+    cerr << "error: could not open executable file " << fileName << endl;
+    return false;
+  }
+
+  // BE->LE swap: Executable files are stored 0A0B0C0D => addr 00,01,02,03
+  //              Read into bytes[] as b[0],b[1],b[2],b[3] = 0A,0B,0C,0D
+  //              Need to swizzle bytes back into little-endian
+  
+  // read # of words in file
+  if(!exeFile.read((char *)&bytes, 4)) {
+    cerr << "error: could not read count from file " << fileName << endl;
+    return false;
+  }
+  count = Memory::swizzle(bytes);
+
+  // read start address from file
+  if(!exeFile.read((char *)&bytes, 4)) {
+    cerr << "error: could not read start addr from file " << fileName << endl;
+    return false;
+  }
+  start = Memory::swizzle(bytes);
+
+  // a corrupt header must not size the text from a bogus count
+  streampos here = exeFile.tellg();
+  exeFile.seekg(0, ios::end);
+  long long words = (exeFile.tellg() - here) / 4;
+  exeFile.seekg(here);
+  if(count < 0 || count > words || (uint32_t)count > (DATA_BASE - TEXT_BASE) / 4) {
+    cerr << "error: bad word count " << count << " in " << fileName << " (" << words
+         << " words follow the header)" << endl;
+    return false;
+  }
+
+  text.resize(count);
+  for(int i = 0; i < count; i++) {
+    if(!exeFile.read((char *)&bytes, 4)) {
+      cerr << "error: could not read words from file" << endl;
+      return false;
+    }
+    text[i] = Memory::swizzle(bytes);
+  }
+  exeFile.close();
+
+  return true;
+}
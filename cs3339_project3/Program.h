@@ -0,0 +1,29 @@
+#ifndef __PROGRAM_H
+#define __PROGRAM_H
+
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Memory.h"
+#include "Debug.h"
+using namespace std;
+
+// A loaded MIPS executable.  Keeping the text image around lets a
+// program be started several times (sampling passes, batch jobs) without
+// going back to the file.
+class Program {
+  public:
+    string name;
+    uint32_t start;
+    vector<uint32_t> text;
+
+    bool load(const char *fileName);
+
+    int getTextWords() const { return text.size(); }
+    bool initInstMem(Memory &iMem) const { return iMem.initFromWords(text.data(), text.size()); }
+    int instMemBytes() const { return text.size() << 4; } // 4 bytes per inst
+};
+
+#endif
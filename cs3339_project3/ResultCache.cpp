@@ -0,0 +1,128 @@
+/*
+ * Content-addressed cache of simulation results.
+ */
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "ResultCache.h"
+
+static const char *MAGIC = "cs3339-sim-result 1\n";
+
+void ContentHash::addBytes(const char *p, size_t n) {
+  for(size_t i = 0; i < n; i++) {
+    uint8_t c = p[i];
+    a = (a ^ c) * 0x100000001b3ULL;
+    b = (b + c + 1) * 0x9e3779b97f4a7c15ULL;
+    b ^= b >> 29;
+  }
+}
+
+void ContentHash::add(const string &part) {
+  uint64_t n = part.size();
+  addBytes((const char *)&n, sizeof(n));
+  addBytes(part.data(), part.size());
+}
+
+string ContentHash::hex() const {
+  char buf[33];
+  snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)a, (unsigned long long)b);
+  return buf;
+}
+
+bool readFile(const char *path, string &contents) {
+  ifstream f(path, ios::binary);
+  if(!f) return false;
+  ostringstream s;
+  s << f.rdbuf();
+  contents = s.str();
+  return true;
+}
+
+ResultCache::ResultCache(const string &dir, long long maxBytes) : dir(dir), maxBytes(maxBytes) {
+  mkdir(dir.c_str(), 0755);
+}
+
+bool ResultCache::lookup(const string &key, string &output) {
+  string file = entry(key), contents;
+  if(!readFile(file.c_str(), contents) || contents.compare(0, strlen(MAGIC), MAGIC))
+    return false;
+  output = contents.substr(strlen(MAGIC));
+  utime(file.c_str(), NULL);   // most recently used
+  return true;
+}
+
+// written under a temporary name and renamed, so a concurrent lookup
+// never sees half an entry
+void ResultCache::store(const string &key, const string &output) {
+  string file = entry(key);
+  ostringstream tmp;
+  tmp << file << ".tmp" << getpid();
+
+  ofstream f(tmp.str().c_str(), ios::binary);
+  if(!f) {
+    cerr << "warning: could not write to result cache " << dir << endl;
+    return;
+  }
+  f << MAGIC << output;
+  f.close();
+  if(!f || rename(tmp.str().c_str(), file.c_str()) < 0) {
+    unlink(tmp.str().c_str());
+    return;
+  }
+  evict();
+}
+
+// oldest entries go first, down to 3/4 of the limit so this doesn't run
+// on every store
+void ResultCache::evict() {
+  vector<pair<time_t, pair<long long, string> > > files;
+  long long total = 0;
+
+  DIR *d = opendir(dir.c_str());
+  if(!d) return;
+  while(dirent *e = readdir(d)) {
+    string name = e->d_name;
+    if(name.size() < 4 || name.compare(name.size() - 4, 4, ".out")) continue;
+    struct stat st;
+    string path = dir + "/" + name;
+    if(stat(path.c_str(), &st) < 0) continue;
+    files.push_back(make_pair(st.st_mtime, make_pair((long long)st.st_size, path)));
+    total += st.st_size;
+  }
+  closedir(d);
+  if(total <= maxBytes) return;
+
+  sort(files.begin(), files.end());
+  for(size_t i = 0; i < files.size() && total > maxBytes / 4 * 3; i++) {
+    if(unlink(files[i].second.second.c_str()) == 0)
+      total -= files[i].second.first;
+  }
+}
+
+OutputCapture::OutputCapture(ostream &os) : os(os), old(os.rdbuf()), tee(old, copy.rdbuf()) {
+  os.rdbuf(&tee);
+}
+
+OutputCapture::~OutputCapture() {
+  os.flush();
+  os.rdbuf(old);
+}
+
+int OutputCapture::TeeBuf::overflow(int c) {
+  if(c == EOF) return 0;
+  if(a->sputc(c) == EOF) return EOF;
+  b->sputc(c);
+  return c;
+}
+
+streamsize OutputCapture::TeeBuf::xsputn(const char *s, streamsize n) {
+  streamsize w = a->sputn(s, n);
+  b->sputn(s, w);
+  return w;
+}
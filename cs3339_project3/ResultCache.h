@@ -0,0 +1,74 @@
+#ifndef __RESULTCACHE_H
+#define __RESULTCACHE_H
+
+#include <iostream>
+#include <sstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Debug.h"
+using namespace std;
+
+// 128-bit content hash for cache keys; parts are length-prefixed so
+// ("ab", "c") and ("a", "bc") differ
+class ContentHash {
+  public:
+    ContentHash() : a(0xcbf29ce484222325ULL), b(0x84222325cbf29ce4ULL) {}
+
+    void add(const string &part);
+    string hex() const;
+
+  private:
+    uint64_t a, b;
+
+    void addBytes(const char *p, size_t n);
+};
+
+// On-disk cache of the output of complete, successful runs, keyed by the
+// content of everything that can change it.  One file per entry; a hit
+// refreshes the file's modification time, and the least recently used
+// entries are removed once the directory outgrows maxBytes.
+class ResultCache {
+  public:
+    ResultCache(const string &dir, long long maxBytes);
+
+    bool lookup(const string &key, string &output);
+    void store(const string &key, const string &output);
+
+  private:
+    string dir;
+    long long maxBytes;
+
+    string entry(const string &key) const { return dir + "/" + key + ".out"; }
+    void evict();
+};
+
+// Tees everything written to os into a string while it is alive
+class OutputCapture {
+  public:
+    OutputCapture(ostream &os = cout);
+    ~OutputCapture();
+
+    string str() const { return copy.str(); }
+
+  private:
+    class TeeBuf : public streambuf {
+      public:
+        TeeBuf(streambuf *a, streambuf *b) : a(a), b(b) {}
+      protected:
+        int overflow(int c);
+        streamsize xsputn(const char *s, streamsize n);
+        int sync() { return a->pubsync(); }
+      private:
+        streambuf *a, *b;
+    };
+
+    ostream &os;
+    ostringstream copy;
+    streambuf *old;
+    TeeBuf tee;
+};
+
+bool readFile(const char *path, string &contents);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __RINGBUFFER_H
+#define __RINGBUFFER_H
+
+#include <atomic>
+#include <thread>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "Debug.h"
+using namespace std;
+
+// Single-producer/single-consumer lock-free ring.  The producer only
+// writes head and the consumer only writes tail, so each side needs one
+// acquire load of the other's index and one release store of its own.
+// Each side also keeps a private copy of the other's index and only
+// re-reads the shared one when the cached value says full/empty.
+template<typename T, size_t SIZE = 1 << 16>
+class RingBuffer {
+  static_assert((SIZE & (SIZE - 1)) == 0, "ring size must be a power of two");
+
+  private:
+    alignas(64) atomic<size_t> head;   // next slot to write (producer)
+    alignas(64) atomic<size_t> tail;   // next slot to read (consumer)
+    alignas(64) atomic<bool> closed;
+    alignas(64) size_t cachedTail;     // producer's view of tail
+    alignas(64) size_t cachedHead;     // consumer's view of head
+    T buf[SIZE];
+
+  public:
+    RingBuffer() : head(0), tail(0), closed(false), cachedTail(0), cachedHead(0) {}
+
+    // Rings are too big for the stack, and before C++17 plain new only
+    // guarantees 16-byte alignment, which would undo the padding above.
+    static RingBuffer *create() {
+      void *p;
+      if(posix_memalign(&p, 64, sizeof(RingBuffer))) return NULL;
+      return new(p) RingBuffer;
+    }
+    static void destroy(RingBuffer *r) {
+      r->~RingBuffer();
+      free(r);
+    }
+
+    // producer side: blocks (yielding) while the ring is full
+    void push(const T &item) {
+      size_t h = head.load(memory_order_relaxed);
+      while(h - cachedTail == SIZE) {
+        cachedTail = tail.load(memory_order_acquire);
+        if(h - cachedTail == SIZE) this_thread::yield();
+      }
+      buf[h & (SIZE - 1)] = item;
+      head.store(h + 1, memory_order_release);
+    }
+
+    // producer side: no more items will be pushed
+    void close() { closed.store(true, memory_order_release); }
+
+    // consumer side: hands every available item to f, returns false once
+    // the ring is closed and drained
+    template<typename F>
+    bool consume(F f) {
+      size_t t = tail.load(memory_order_relaxed);
+      if(t == cachedHead) {
+        bool done = closed.load(memory_order_acquire);
+        cachedHead = head.load(memory_order_acquire);
+        if(t == cachedHead) {
+          if(done) return false;
+          this_thread::yield();
+          return true;
+        }
+      }
+      for(; t != cachedHead; t++)
+        f(buf[t & (SIZE - 1)]);
+      tail.store(t, memory_order_release);
+      return true;
+    }
+};
+
+#endif
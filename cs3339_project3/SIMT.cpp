@@ -0,0 +1,327 @@
+/*
+ * Lockstep SIMT execution of many instances of one program.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include "SIMT.h"
+#include "CPU.h"
+
+SIMTEngine::SIMTEngine(const Program &prog, const vector<string> &inputs)
+    : prog(prog), K(inputs.size()), regs((size_t)34 * inputs.size(), 0), pages((size_t)PAGES * inputs.size(), NULL),
+      insts(inputs.size(), 0), faults(inputs.size(), FAULT_NONE) {
+  // instruction memory is four times the text, the rest reads as sll $0, $0, 0
+  code.resize(prog.instMemBytes() >> 2);
+  for(size_t i = 0; i < code.size(); i++) {
+    uint32_t instr = i < prog.text.size() ? prog.text[i] : 0;
+    Inst &d = code[i];
+    d.opcode = instr >> 26;
+    d.rs = (instr >> 21) & 0x1f;
+    d.rt = (instr >> 16) & 0x1f;
+    d.rd = (instr >> 11) & 0x1f;
+    d.shamt = (instr >> 6) & 0x1f;
+    d.funct = instr & 0x3f;
+    d.uimm = instr & 0xffff;
+    d.simm = ((signed)d.uimm << 16) >> 16;
+    d.target = (instr & 0x3ffffff) << 2;
+  }
+
+  for(int l = 0; l < K; l++) {
+    R(28)[l] = 0x10008000;           // gp, as in CPU
+    R(29)[l] = DATA_BASE + MEMSIZE;  // sp
+    ins.push_back(new istringstream(inputs[l]));
+    outs.push_back(new ostringstream);
+  }
+
+  Group all;
+  all.pc = prog.start;
+  vector<int> lanes;
+  for(int l = 0; l < K; l++)
+    lanes.push_back(l);
+  setLanes(all, lanes);
+  if(K > 0) groups.push_back(all);
+
+  steps = laneSteps = splits = merges = 0;
+  host = 0.0;
+}
+
+SIMTEngine::~SIMTEngine() {
+  for(size_t p = 0; p < pages.size(); p++)
+    free(pages[p]);
+  for(int l = 0; l < K; l++) {
+    delete ins[l];
+    delete outs[l];
+  }
+}
+
+// the lane's data word at addr, NULL (with the message Memory prints) if
+// it is not accessible
+uint32_t *SIMTEngine::word(int lane, uint32_t addr, bool isStore) {
+  if((addr & 3) != 0) {
+    cerr << "unaligned data" << (isStore ? " access: 0x" : " memory access: 0x") << hex << addr << dec << endl;
+    faults[lane] = FAULT_UNALIGNED;
+    return NULL;
+  }
+  uint32_t index = (addr - DATA_BASE) >> 2;
+  if(index >= (uint32_t)(MEMSIZE >> 2)) {
+    cerr << "data memory access out of range: 0x" << hex << addr << dec << endl;
+    faults[lane] = FAULT_RANGE;
+    return NULL;
+  }
+  uint32_t *&page = pages[(size_t)lane * PAGES + index / PAGE_WORDS];
+  if(!page) page = (uint32_t *)calloc(PAGE_WORDS, sizeof(uint32_t));
+  return page + index % PAGE_WORDS;
+}
+
+void SIMTEngine::setLanes(Group &g, const vector<int> &lanes) {
+  g.lanes = lanes;
+  g.mask.assign(K, 0);
+  for(size_t i = 0; i < lanes.size(); i++)
+    g.mask[lanes[i]] = 1;
+  g.dense = lanes.size() * 4 >= (size_t)K;
+}
+
+// next[l] is lane l's next pc; lanes bound elsewhere than the lowest
+// target go to new groups
+void SIMTEngine::split(Group &g, const vector<uint32_t> &next) {
+  map<uint32_t, vector<int> > by;
+  for(size_t i = 0; i < g.lanes.size(); i++)
+    by[next[g.lanes[i]]].push_back(g.lanes[i]);
+
+  if(by.size() == 1) {
+    g.pc = by.begin()->first;
+    return;
+  }
+  // g keeps the first target; g refers into groups, so set it up before
+  // adding the others
+  splits++;
+  map<uint32_t, vector<int> >::iterator it = by.begin();
+  g.pc = it->first;
+  setLanes(g, it->second);
+  for(++it; it != by.end(); ++it) {
+    Group ng;
+    ng.pc = it->first;
+    setLanes(ng, it->second);
+    groups.push_back(ng);
+  }
+}
+
+// lanes that exited or faulted leave the group
+void SIMTEngine::retire(Group &g, const vector<int> &gone) {
+  if(gone.empty()) return;
+  for(size_t i = 0; i < gone.size(); i++)
+    g.mask[gone[i]] = 0;
+  vector<int> left;
+  for(size_t i = 0; i < g.lanes.size(); i++)
+    if(g.mask[g.lanes[i]]) left.push_back(g.lanes[i]);
+  setLanes(g, left);
+}
+
+bool SIMTEngine::run() {
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+  while(!groups.empty()) {
+    // lowest pc first, merging every group already waiting there
+    size_t g = 0;
+    for(size_t i = 1; i < groups.size(); i++)
+      if(groups[i].pc < groups[g].pc) g = i;
+    for(size_t i = 0; i < groups.size(); i++) {
+      if(i == g || groups[i].pc != groups[g].pc) continue;
+      vector<int> lanes = groups[g].lanes;
+      lanes.insert(lanes.end(), groups[i].lanes.begin(), groups[i].lanes.end());
+      setLanes(groups[g], lanes);
+      groups[i].lanes.clear();
+      merges++;
+    }
+
+    step(groups[g]);
+
+    size_t kept = 0;
+    for(size_t i = 0; i < groups.size(); i++)
+      if(!groups[i].lanes.empty()) {
+        if(kept != i) groups[kept] = groups[i];
+        kept++;
+      }
+    groups.resize(kept);
+  }
+
+  chrono::duration<double> t = chrono::steady_clock::now() - t0;
+  host = t.count();
+  for(int l = 0; l < K; l++)
+    if(faults[l] != FAULT_NONE) return false;
+  return true;
+}
+
+// runs the instruction at g.pc for every lane of g, as CPU::run would
+void SIMTEngine::step(Group &g) {
+  uint32_t index = (g.pc - TEXT_BASE) >> 2;
+  vector<int> gone;
+
+  steps++;
+  laneSteps += g.lanes.size();
+  for(size_t i = 0; i < g.lanes.size(); i++)
+    insts[g.lanes[i]]++;
+
+  if((g.pc & 3) != 0 || index >= code.size()) {
+    for(size_t i = 0; i < g.lanes.size(); i++) {
+      if(g.pc & 3) cerr << "unaligned inst memory access: 0x" << hex << g.pc << dec << endl;
+      else cerr << "inst memory access out of range: 0x" << hex << g.pc << dec << endl;
+      faults[g.lanes[i]] = (g.pc & 3) ? FAULT_UNALIGNED : FAULT_RANGE;
+    }
+    g.lanes.clear();
+    return;
+  }
+
+  const Inst &d = code[index];
+  uint32_t *rs = R(d.rs), *rt = R(d.rt), *hi = R(HI), *lo = R(LO);
+  uint32_t next = g.pc + 4;
+  int32_t simm = d.simm;
+  uint32_t uimm = d.uimm, shamt = d.shamt;
+
+  switch(d.opcode) {
+    case 0x00:
+      switch(d.funct) {
+        case 0x00: if(d.rd) write(g, R(d.rd), [rs, shamt](int l) { return rs[l] << shamt; }); break;   // sll
+        case 0x03: if(d.rd) write(g, R(d.rd), [rs, shamt](int l) { return (uint32_t)((int32_t)rs[l] >> shamt); }); break;   // sra
+        case 0x08: {   // jr
+          vector<uint32_t> to(K);
+          for(size_t i = 0; i < g.lanes.size(); i++)
+            to[g.lanes[i]] = rs[g.lanes[i]];
+          split(g, to);
+          return;
+        }
+        case 0x10: if(d.rd) write(g, R(d.rd), [hi](int l) { return hi[l]; }); break;   // mfhi
+        case 0x12: if(d.rd) write(g, R(d.rd), [lo](int l) { return lo[l]; }); break;   // mflo
+        case 0x18:   // mult
+          write(g, hi, [rs, rt](int l) { return (uint32_t)(((uint64_t)rs[l] * rt[l]) >> 32); });
+          write(g, lo, [rs, rt](int l) { return rs[l] * rt[l]; });
+          break;
+        case 0x1a:   // div: lanes dividing by zero fault before writing hi/lo
+          for(size_t i = 0; i < g.lanes.size(); i++)
+            if(rt[g.lanes[i]] == 0) {
+              cerr << "division by zero!" << endl;
+              faults[g.lanes[i]] = FAULT_DIV_ZERO;
+              gone.push_back(g.lanes[i]);
+            }
+          retire(g, gone);
+          write(g, hi, [rs, rt](int l) { return rt[l] ? rs[l] % rt[l] : 0; });
+          write(g, lo, [rs, rt](int l) { return rt[l] ? rs[l] / rt[l] : 0; });
+          break;
+        case 0x21: if(d.rd) write(g, R(d.rd), [rs, rt](int l) { return rs[l] + rt[l]; }); break;   // addu
+        case 0x23: if(d.rd) write(g, R(d.rd), [rs, rt](int l) { return rs[l] - rt[l]; }); break;   // subu
+        case 0x2a: if(d.rd) write(g, R(d.rd), [rs, rt](int l) { return (uint32_t)((int32_t)rs[l] < (int32_t)rt[l]); }); break;   // slt
+        default: cerr << "unimplemented instruction: pc = 0x" << hex << g.pc << dec << endl;
+      }
+      break;
+    case 0x02: next = (g.pc & 0xf0000000) | d.target; break;   // j
+    case 0x03: {   // jal
+      uint32_t ra = g.pc + 4;
+      write(g, R(31), [ra](int) { return ra; });
+      next = (g.pc & 0xf0000000) | d.target;
+      break;
+    }
+    case 0x04:     // beq
+    case 0x05: {   // bne
+      vector<uint32_t> to(K);
+      bool ne = d.opcode == 0x05;
+      for(size_t i = 0; i < g.lanes.size(); i++) {
+        int l = g.lanes[i];
+        to[l] = ((rs[l] != rt[l]) == ne) ? next + (simm << 2) : next;
+      }
+      split(g, to);
+      return;
+    }
+    case 0x09: if(d.rt) write(g, rt, [rs, simm](int l) { return rs[l] + simm; }); break;   // addiu
+    case 0x0c: if(d.rt) write(g, rt, [rs, uimm](int l) { return rs[l] & uimm; }); break;   // andi
+    case 0x0f: if(d.rt) write(g, rt, [simm](int) { return (uint32_t)simm << 16; }); break;   // lui
+    case 0x1a:     // trap
+      for(size_t i = 0; i < g.lanes.size(); i++) {
+        int l = g.lanes[i];
+        switch(d.target >> 2 & 0xf) {
+          case 0x0: *outs[l] << endl; break;
+          case 0x1: *outs[l] << " " << (signed)rs[l]; break;
+          case 0x5: *outs[l] << endl << "? "; *ins[l] >> rt[l]; break;
+          case 0x6: rt[l] = 0; break;   // one core per instance
+          case 0x7: rt[l] = 1; break;
+          case 0xa: gone.push_back(l); break;
+          default: cerr << "unimplemented trap: pc = 0x" << hex << g.pc << dec << endl;
+                   gone.push_back(l);
+        }
+      }
+      retire(g, gone);
+      break;
+    case 0x23:     // lw
+    case 0x30:     // ll
+      for(size_t i = 0; i < g.lanes.size(); i++) {
+        int l = g.lanes[i];
+        uint32_t *w = word(l, rs[l] + simm, false);
+        if(!w) gone.push_back(l);
+        else if(d.rt) rt[l] = *w;
+      }
+      retire(g, gone);
+      break;
+    case 0x2b:     // sw
+    case 0x38:     // sc, which can't fail with one core
+      for(size_t i = 0; i < g.lanes.size(); i++) {
+        int l = g.lanes[i];
+        uint32_t *w = word(l, rs[l] + simm, true);
+        if(!w) gone.push_back(l);
+        else {
+          *w = rt[l];
+          if(d.opcode == 0x38 && d.rt) rt[l] = 1;
+        }
+      }
+      retire(g, gone);
+      break;
+    default: cerr << "unimplemented instruction: pc = 0x" << hex << g.pc << dec << endl;
+  }
+  g.pc = next;
+}
+
+void SIMTEngine::report(ostream &out, bool verify) {
+  long long total = 0;
+  int faulted = 0;
+
+  for(int l = 0; l < K; l++) {
+    out << "instance " << l << " (" << insts[l] << " instructions";
+    if(faults[l] != FAULT_NONE) {
+      out << ", " << faultName(faults[l]);
+      faulted++;
+    }
+    out << "):" << outs[l]->str() << endl;
+    total += insts[l];
+  }
+
+  out << endl << "SIMT: " << K << " instances, " << total << " instructions in " << steps << " group steps, "
+      << fixed << setprecision(1) << (steps ? (double)laneSteps / steps : 0.0) << " lanes per step on average" << endl;
+  out << "  " << splits << " divergent branches/jr, " << merges << " regroupings";
+  if(faulted) out << ", " << faulted << " instances faulted";
+  out << endl;
+  out << "  host time " << setprecision(3) << host << " s, " << setprecision(1)
+      << (host > 0.0 ? total / host / 1e6 : 0.0) << " M guest instructions/s" << endl;
+
+  if(!verify) return;
+
+  // the same instances one at a time on the functional CPU
+  int mismatches = 0;
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for(int l = 0; l < K; l++) {
+    Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+    Memory dataMem(MEMSIZE, DATA_BASE, true);
+    FunctionalCPU cpu(prog.start, instMem, dataMem);
+    istringstream in(ins[l]->str());
+    ostringstream o;
+    prog.initInstMem(instMem);
+    cpu.setIO(in, o);
+    cpu.run();
+    if(o.str() != outs[l]->str() || cpu.getInstructions() != insts[l] || cpu.getFault() != faults[l]) {
+      if(mismatches++ == 0)
+        out << "  instance " << l << " differs: " << cpu.getInstructions() << " instructions on the CPU" << endl;
+    }
+  }
+  chrono::duration<double> t = chrono::steady_clock::now() - t0;
+  out << "  separate runs: " << setprecision(3) << t.count() << " s, " << setprecision(1)
+      << total / t.count() / 1e6 << " M guest instructions/s, " << setprecision(2)
+      << (host > 0.0 ? t.count() / host : 0.0) << "x speedup, " << mismatches << " mismatches" << endl;
+}
@@ -0,0 +1,90 @@
+#ifndef __SIMT_H
+#define __SIMT_H
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "Memory.h"
+#include "Fault.h"
+#include "Debug.h"
+using namespace std;
+
+// Functional execution of many instances of one program in lockstep, one
+// lane per instance, each with its own trap input.  Registers are stored
+// structure-of-arrays (reg[r][lane]) so an ALU instruction is one loop over
+// the lanes of a group, which the compiler vectorizes.  A group is a set of
+// lanes at the same pc; a branch or jr on which its lanes disagree splits
+// it, and groups that reach the same pc are merged again.  The group with
+// the lowest pc always runs next, which holds the lanes that skipped ahead
+// at loop exits and if/else joins until the rest catch up.
+class SIMTEngine {
+  public:
+    SIMTEngine(const Program &prog, const vector<string> &inputs);
+    ~SIMTEngine();
+
+    // returns false if any instance faulted
+    bool run();
+    void report(ostream &out, bool verify);
+
+  private:
+    static const int PAGE_WORDS = 1024;
+    static const int PAGES = MEMSIZE / (PAGE_WORDS * 4);
+    static const int HI = 32, LO = 33;
+
+    // predecoded text word
+    struct Inst {
+      uint8_t opcode, rs, rt, rd, shamt, funct;
+      int32_t simm;
+      uint32_t uimm, target;
+    };
+
+    struct Group {
+      uint32_t pc;
+      vector<int> lanes;
+      vector<uint8_t> mask;   // mask[lane] != 0 iff lane is in the group
+      bool dense;             // worth running over all lanes with the mask
+    };
+
+    const Program &prog;
+    int K;
+    vector<Inst> code;
+    vector<uint32_t> regs;        // 34 rows of K: GPRs, hi, lo
+    vector<uint32_t *> pages;     // K * PAGES data pages, allocated on first touch
+    vector<long long> insts;      // per lane
+    vector<FAULT> faults;
+    vector<istringstream *> ins;
+    vector<ostringstream *> outs;
+    vector<Group> groups;
+
+    long long steps, laneSteps, splits, merges;
+    double host;
+
+    uint32_t *R(int r) { return &regs[(size_t)r * K]; }
+    uint32_t *word(int lane, uint32_t addr, bool isStore);
+
+    void setLanes(Group &g, const vector<int> &lanes);
+    void split(Group &g, const vector<uint32_t> &next);
+    void retire(Group &g, const vector<int> &gone);
+    void step(Group &g);
+
+    // dst[l] = f(l) for every lane l of g
+    template<class F> void write(const Group &g, uint32_t *dst, F f) {
+      if(g.dense) {
+        const uint8_t *m = g.mask.data();
+        for(int l = 0; l < K; l++)
+          dst[l] = m[l] ? f(l) : dst[l];
+      }
+      else {
+        for(size_t i = 0; i < g.lanes.size(); i++) {
+          int l = g.lanes[i];
+          dst[l] = f(l);
+        }
+      }
+    }
+};
+
+#endif
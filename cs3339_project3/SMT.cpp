@@ -0,0 +1,193 @@
+/*
+ * Fine-grained multithreaded (barrel/SMT) timing model.  Cycle numbers
+ * count the cycle in which an instruction leaves ID, as in Superscalar.
+ */
+
+#include <chrono>
+#include <cstring>
+#include "SMT.h"
+
+bool parseSMTPolicy(const char *name, SMT_POLICY &policy) {
+  if(!strcmp(name, "rr")) policy = SMT_ROUND_ROBIN;
+  else if(!strcmp(name, "icount")) policy = SMT_ICOUNT;
+  else if(!strcmp(name, "stall")) policy = SMT_SWITCH_ON_STALL;
+  else return false;
+  return true;
+}
+
+SMTModel::Context::Context(const Program &prog, const Stats &base, const string &input)
+    : instMem(prog.instMemBytes(), TEXT_BASE, false), dataMem(MEMSIZE, DATA_BASE, true),
+      cpu(prog.start, instMem, dataMem), alone(base), in(input) {
+  prog.initInstMem(instMem);
+  cpu.setIO(in, out);
+  cpu.setTraceSink(this);
+  for(int i = 0; i < 33; i++)
+    regReady[i] = 0;
+  redirect = 0;
+  issued = 0;
+  live = true;
+}
+
+bool SMTModel::Context::step() {
+  long long n = cpu.getInstructions();
+  cpu.run(n + 1);
+  live = cpu.getInstructions() > n;
+  return live;
+}
+
+long long SMTModel::Context::readyAt() const {
+  long long ready = redirect;
+  for(int s = 0; s < 2; s++)
+    if(head.src[s] > 0 && regReady[head.src[s]] > ready)
+      ready = regReady[head.src[s]];
+  return ready;
+}
+
+SMTModel::SMTModel(const Program &prog, const SMTConfig &cfg, const Stats &base)
+    : prog(prog), cfg(cfg), base(base) {
+  for(int t = 0; t < cfg.threads; t++)
+    ctx.push_back(NULL);
+  cycle = lastIssue = 0;
+  last = cfg.threads - 1;
+  for(int i = 0; i < WB - ID; i++)
+    hist[i] = -1;
+  switchUntil = switches = 0;
+  for(int i = 0; i < IDLES; i++)
+    idle[i] = 0;
+}
+
+SMTModel::~SMTModel() {
+  for(size_t t = 0; t < ctx.size(); t++)
+    delete ctx[t];
+}
+
+// instructions the thread has in EXE1..MEM2
+int SMTModel::inFlight(int t) const {
+  int n = 0;
+  for(int i = 0; i < WB - ID; i++)
+    if(hist[i] == t) n++;
+  return n;
+}
+
+// thread to issue from this cycle, -1 if none can
+int SMTModel::pick() {
+  int best = -1, T = cfg.threads;
+
+  if(cfg.policy == SMT_SWITCH_ON_STALL) {
+    // stay on the current thread until it stalls, then switch to the
+    // thread that will be ready soonest if that beats waiting out the stall
+    if(cycle < switchUntil) return -1;
+    if(ctx[last]->live && ctx[last]->readyAt() <= cycle) return last;
+    long long soonest = 0;
+    for(int k = 1; k <= T; k++) {
+      int t = (last + k) % T;
+      if(!ctx[t]->live || t == last) continue;
+      if(best < 0 || ctx[t]->readyAt() < soonest) {
+        best = t;
+        soonest = ctx[t]->readyAt();
+      }
+    }
+    if(best >= 0 && (!ctx[last]->live || max(soonest, cycle + cfg.switchPenalty) < ctx[last]->readyAt())) {
+      last = best;
+      switchUntil = cycle + cfg.switchPenalty;
+      switches++;
+      if(cycle < switchUntil) return -1;
+      return ctx[last]->readyAt() <= cycle ? last : -1;
+    }
+    return -1;
+  }
+
+  // round robin from the thread after the last one to issue; ICOUNT takes
+  // the one with the fewest instructions in flight, ties in the same order
+  int fewest = WB - ID + 1;
+  for(int k = 1; k <= T; k++) {
+    int t = (last + k) % T;
+    if(!ctx[t]->live || ctx[t]->readyAt() > cycle) continue;
+    if(cfg.policy == SMT_ROUND_ROBIN) return t;
+    int f = inFlight(t);
+    if(f < fewest) {
+      best = t;
+      fewest = f;
+    }
+  }
+  return best;
+}
+
+FAULT SMTModel::run(const vector<string> &inputs, ostream &out) {
+  FAULT fault = FAULT_NONE;
+  int live = 0;
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for(int t = 0; t < cfg.threads; t++)
+    ctx[t] = new Context(prog, base, inputs[t]);
+  for(int t = 0; t < cfg.threads; t++)
+    if(ctx[t]->step()) live++;
+
+  while(live > 0) {
+    int t = pick();
+    hist[cycle % (WB - ID)] = t;
+
+    if(t >= 0) {
+      Context &c = *ctx[t];
+      if(c.head.dest >= 0)
+        c.regReady[c.head.dest] = cycle + (WB - ID);
+      if(c.head.flags & (REC_TAKEN | REC_JUMP | REC_JR))
+        c.redirect = cycle + 3;   // two flushed fetch slots
+      c.issued++;
+      last = t;
+      lastIssue = cycle;
+      if(!c.step()) {
+        live--;
+        if(c.cpu.getFault() != FAULT_NONE) {
+          fault = c.cpu.getFault();
+          break;
+        }
+      }
+    }
+    else if(cycle < switchUntil)
+      idle[IDLE_SWITCH]++;
+    else {
+      // nobody could go: blame the thread that will be ready soonest
+      int w = -1;
+      for(int k = 0; k < cfg.threads; k++)
+        if(ctx[k]->live && (w < 0 || ctx[k]->readyAt() < ctx[w]->readyAt())) w = k;
+      idle[ctx[w]->redirect > cycle ? IDLE_FLUSH : IDLE_RAW]++;
+    }
+    cycle++;
+  }
+  chrono::duration<double> host = chrono::steady_clock::now() - t0;
+
+  if(fault == FAULT_NONE)
+    report(out, host.count());
+  return fault;
+}
+
+void SMTModel::report(ostream &out, double host) {
+  static const char *policies[] = { "round-robin", "ICOUNT", "switch-on-stall" };
+  long long cycles = lastIssue + PIPESTAGES, insts = 0, aloneCycles = 0;
+
+  for(int t = 0; t < cfg.threads; t++) {
+    const string &text = ctx[t]->out.str();
+    if(text.empty()) continue;
+    out << "thread " << t << " output:" << text;
+    if(text[text.size() - 1] != '\n') out << endl;
+  }
+
+  out << endl << "SMT model: " << cfg.threads << " thread context" << (cfg.threads > 1 ? "s, " : ", ") << policies[cfg.policy] << " fetch";
+  if(cfg.policy == SMT_SWITCH_ON_STALL)
+    out << ", " << switches << " switches of " << cfg.switchPenalty << " cycles";
+  out << endl;
+  out << "  Cycles: " << cycles << endl;
+  for(int t = 0; t < cfg.threads; t++) {
+    long long n = ctx[t]->issued, alone = ctx[t]->alone.getCycles();
+    out << "  thread " << t << ": " << n << " instructions, IPC " << fixed << setprecision(3)
+        << (double)n / cycles << " (alone " << (double)n / alone << ")" << endl;
+    insts += n;
+    aloneCycles += alone;
+  }
+  out << "  aggregate IPC " << setprecision(3) << (double)insts / cycles << ", "
+      << setprecision(2) << (double)aloneCycles / cycles << "x the throughput of running the threads one after another" << endl;
+  out << "  Cycles with no instruction leaving ID: " << idle[IDLE_RAW] + idle[IDLE_FLUSH] + idle[IDLE_SWITCH]
+      << " (" << idle[IDLE_RAW] << " RAW, " << idle[IDLE_FLUSH] << " flush, " << idle[IDLE_SWITCH]
+      << " thread switch), host time " << setprecision(2) << host << " s" << endl;
+}
@@ -0,0 +1,87 @@
+#ifndef __SMT_H
+#define __SMT_H
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+enum SMT_POLICY { SMT_ROUND_ROBIN, SMT_ICOUNT, SMT_SWITCH_ON_STALL };
+
+struct SMTConfig {
+  int threads;          // hardware contexts
+  SMT_POLICY policy;
+  int switchPenalty;    // cycles to refill IF1/IF2 when switch-on-stall changes thread
+
+  SMTConfig() : threads(4), policy(SMT_ROUND_ROBIN), switchPenalty(2) {}
+};
+
+bool parseSMTPolicy(const char *name, SMT_POLICY &policy);
+
+// Several hardware thread contexts sharing the 8-stage Stats pipeline.
+// Every context runs its own copy of the program (registers, pc, hi/lo,
+// data memory and trap input, which may differ per context) and is resumed one instruction at a time,
+// so all of them are coroutines on the calling thread.  One instruction
+// leaves ID per cycle, chosen by the fetch policy among the contexts whose
+// next instruction is free of hazards.  Hazards follow Stats but are per
+// context: a RAW or a taken-branch flush only blocks its own thread, and
+// the slots it would have wasted go to the others.  With one context the
+// cycle count matches Stats exactly.
+class SMTModel {
+  public:
+    SMTModel(const Program &prog, const SMTConfig &cfg, const Stats &base);
+    ~SMTModel();
+
+    // inputs: the trap input of each context
+    FAULT run(const vector<string> &inputs, ostream &out);
+
+  private:
+    enum IDLE { IDLE_RAW, IDLE_FLUSH, IDLE_SWITCH, IDLES };
+
+    // captures the record of the one instruction a context just ran
+    struct Context : public TraceSink {
+      Memory instMem, dataMem;
+      CPU cpu;
+      Stats alone;            // the same thread timed on its own
+      istringstream in;
+      ostringstream out;
+
+      InstRecord head;        // next instruction to issue
+      bool live;
+      long long regReady[33]; // first cycle a reader may leave ID
+      long long redirect;     // first cycle after a flush
+      long long issued;
+
+      Context(const Program &prog, const Stats &base, const string &input);
+      void consume(const InstRecord &rec) { head = rec; alone.process(rec); }
+      bool step();            // runs the next instruction, false once the program ends
+      long long readyAt() const;
+    };
+
+    const Program &prog;
+    SMTConfig cfg;
+    Stats base;
+    vector<Context *> ctx;
+
+    long long cycle;          // cycle in which the next instruction leaves ID
+    long long lastIssue;
+    int last;                 // thread issued most recently
+    int hist[WB - ID];        // thread that issued in each of the last cycles, -1 if none
+    long long switchUntil, switches;
+    long long idle[IDLES];
+
+    int pick();
+    int inFlight(int t) const;
+    void report(ostream &out, double host);
+};
+
+#endif
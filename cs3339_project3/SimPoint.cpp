@@ -0,0 +1,350 @@
+/*
+ * SimPoint-style sampled simulation.  The program is run twice from the
+ * same recorded trap input: once functionally to build basic-block vectors,
+ * and once with detailed pipeline timing switched on only around the
+ * chosen simulation points.
+ */
+
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "SimPoint.h"
+#include "CPU.h"
+#include "Memory.h"
+
+namespace {
+
+// Pass 1: accumulates instructions per basic block (indexed by the
+// instruction memory word of the block's first instruction, which may lie
+// past the text if the program runs away) and projects each finished
+// interval's vector onto a fixed random basis.
+class BBVCollector : public TraceSink {
+  public:
+    vector<long> counts;
+    vector<int> touched;
+    vector<float> proj;        // instWords x DIMS
+    int leader;
+    bool blockEnded;
+    long inInterval, interval;
+    long memops, branches, taken;
+    Stats *timing;
+    vector<vector<double> > vecs;
+    vector<long> lengths;
+
+    BBVCollector(int instWords, long interval, Stats *timing)
+      : counts(instWords, 0), proj((size_t)instWords * SimPoint::DIMS),
+        leader(0), blockEnded(true), inInterval(0), interval(interval),
+        memops(0), branches(0), taken(0), timing(timing) {
+      mt19937 rng(3339);
+      uniform_real_distribution<float> dist(-1.0f, 1.0f);
+      for(size_t i = 0; i < proj.size(); i++)
+        proj[i] = dist(rng);
+    }
+
+    void consume(const InstRecord &rec) {
+      if(blockEnded) {
+        leader = (rec.pc - TEXT_BASE) >> 2;
+        blockEnded = false;
+      }
+      if(counts[leader]++ == 0)
+        touched.push_back(leader);
+      blockEnded = rec.flags & (REC_BRANCH | REC_JUMP | REC_JR);
+
+      if(rec.flags & (REC_LOAD | REC_STORE)) memops++;
+      if(rec.flags & REC_BRANCH) branches++;
+      if(rec.flags & REC_TAKEN) taken++;
+      if(timing) timing->process(rec);
+
+      if(++inInterval == interval)
+        finishInterval();
+    }
+
+    void finishInterval() {
+      if(inInterval == 0) return;
+      vector<double> v(SimPoint::DIMS, 0.0);
+      for(size_t t = 0; t < touched.size(); t++) {
+        int b = touched[t];
+        double w = (double)counts[b] / inInterval;
+        for(int d = 0; d < SimPoint::DIMS; d++)
+          v[d] += w * proj[(size_t)b * SimPoint::DIMS + d];
+        counts[b] = 0;
+      }
+      touched.clear();
+      vecs.push_back(v);
+      lengths.push_back(inInterval);
+      inInterval = 0;
+    }
+};
+
+// Pass 2: runs the timing model only inside [start - warmup, start + length)
+// of each chosen interval and records the counter deltas over the interval.
+class SampleTimer : public TraceSink {
+  public:
+    struct Window { long warm, start, end; int slot; };
+
+    vector<Window> windows;    // sorted by start
+    size_t next;
+    long n, timed;
+    Stats timing;
+    long long c0, b0, f0;
+    vector<long long> cycles, bubbles, flushes;
+
+    SampleTimer(const vector<Window> &w, int slots, const Stats &base)
+      : windows(w), next(0), n(0), timed(0), timing(base), c0(0), b0(0), f0(0),
+        cycles(slots, 0), bubbles(slots, 0), flushes(slots, 0) {}
+
+    void consume(const InstRecord &rec) {
+      if(next < windows.size()) {
+        const Window &w = windows[next];
+        if(n >= w.warm) {
+          if(n == w.start) {
+            c0 = timing.getCycles();
+            b0 = timing.getBubbles();
+            f0 = timing.getFlushes();
+          }
+          timing.process(rec);
+          timed++;
+          if(n + 1 == w.end) {
+            cycles[w.slot] = timing.getCycles() - c0;
+            bubbles[w.slot] = timing.getBubbles() - b0;
+            flushes[w.slot] = timing.getFlushes() - f0;
+            next++;
+          }
+        }
+      }
+      n++;
+    }
+};
+
+bool byStart(const SampleTimer::Window &a, const SampleTimer::Window &b) {
+  return a.start < b.start;
+}
+
+}
+
+// local timing models start as copies of the configured, still idle, base one
+SimPoint::SimPoint(const Program &prog, const Stats &base, const SimPointConfig &cfg)
+    : prog(prog), cfg(cfg), base(base), full(base) {
+  k = 0;
+  instructions = memops = branches = taken = detailed = 0;
+}
+
+FAULT SimPoint::run(const string &input) {
+  vector<Sample> samples;
+
+  // the second pass replays the same input, so only the first can fault
+  FAULT fault = profile(input);
+  if(fault != FAULT_NONE)
+    return fault;
+  cluster();
+  simulate(input, samples);
+  report(samples);
+  return FAULT_NONE;
+}
+
+FAULT SimPoint::profile(const string &input) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  CPU cpu(prog.start, instMem, dataMem);
+  istringstream in(input);
+  BBVCollector bbv(prog.instMemBytes() >> 2, cfg.interval, cfg.verify ? &full : NULL);
+
+  prog.initInstMem(instMem);
+  cpu.setIO(in, cout);
+  cpu.setTraceSink(&bbv);
+  if(cpu.run() != FAULT_NONE)
+    return cpu.getFault();
+  bbv.finishInterval();
+
+  instructions = cpu.getInstructions();
+  memops = bbv.memops;
+  branches = bbv.branches;
+  taken = bbv.taken;
+
+  points.resize(bbv.vecs.size());
+  for(size_t i = 0; i < points.size(); i++) {
+    for(int d = 0; d < DIMS; d++)
+      points[i].v[d] = bbv.vecs[i][d];
+    points[i].length = bbv.lengths[i];
+    points[i].cluster = 0;
+  }
+  return FAULT_NONE;
+}
+
+static double dist2(const double *a, const double *b, int n) {
+  double s = 0.0;
+  for(int d = 0; d < n; d++)
+    s += (a[d] - b[d]) * (a[d] - b[d]);
+  return s;
+}
+
+// Weighted k-means (weight = interval length) with k-means++ seeding.
+// A few seeds are tried and the lowest-distortion clustering is kept.
+void SimPoint::cluster() {
+  const int SEEDS = 5, ITERS = 100;
+  int n = points.size();
+  vector<int> best(n, 0);
+  double bestCost = -1.0;
+
+  k = min(cfg.clusters, n);
+  for(int s = 0; s < SEEDS; s++) {
+    mt19937 rng(s + 1);
+    vector<double> cent((size_t)k * DIMS);
+    vector<double> d(n, 0.0);
+    vector<int> assign(n, -1);
+
+    // k-means++ seeding
+    int first = uniform_int_distribution<int>(0, n - 1)(rng);
+    copy(points[first].v, points[first].v + DIMS, cent.begin());
+    for(int c = 1; c < k; c++) {
+      double total = 0.0;
+      for(int i = 0; i < n; i++) {
+        d[i] = -1.0;
+        for(int j = 0; j < c; j++) {
+          double dd = dist2(points[i].v, &cent[(size_t)j * DIMS], DIMS);
+          if(d[i] < 0.0 || dd < d[i]) d[i] = dd;
+        }
+        total += d[i];
+      }
+      double r = uniform_real_distribution<double>(0.0, total)(rng);
+      int pick = 0;
+      for(; pick < n - 1 && r >= d[pick]; pick++)
+        r -= d[pick];
+      copy(points[pick].v, points[pick].v + DIMS, cent.begin() + (size_t)c * DIMS);
+    }
+
+    // Lloyd iterations
+    double cost = 0.0;
+    for(int it = 0; it < ITERS; it++) {
+      bool changed = false;
+      cost = 0.0;
+      for(int i = 0; i < n; i++) {
+        int bc = 0;
+        double bd = dist2(points[i].v, &cent[0], DIMS);
+        for(int c = 1; c < k; c++) {
+          double dd = dist2(points[i].v, &cent[(size_t)c * DIMS], DIMS);
+          if(dd < bd) { bd = dd; bc = c; }
+        }
+        if(assign[i] != bc) { assign[i] = bc; changed = true; }
+        cost += bd * points[i].length;
+      }
+      if(!changed) break;
+
+      vector<double> sum((size_t)k * DIMS, 0.0), w(k, 0.0);
+      for(int i = 0; i < n; i++) {
+        for(int dd = 0; dd < DIMS; dd++)
+          sum[(size_t)assign[i] * DIMS + dd] += points[i].v[dd] * points[i].length;
+        w[assign[i]] += points[i].length;
+      }
+      for(int c = 0; c < k; c++)
+        if(w[c] > 0.0)
+          for(int dd = 0; dd < DIMS; dd++)
+            cent[(size_t)c * DIMS + dd] = sum[(size_t)c * DIMS + dd] / w[c];
+    }
+
+    if(bestCost < 0.0 || cost < bestCost) {
+      bestCost = cost;
+      best = assign;
+    }
+  }
+
+  // representative = member closest to its cluster's centroid
+  vector<double> cent((size_t)k * DIMS, 0.0), w(k, 0.0);
+  clusterInsts.assign(k, 0);
+  for(int i = 0; i < n; i++) {
+    points[i].cluster = best[i];
+    for(int d = 0; d < DIMS; d++)
+      cent[(size_t)best[i] * DIMS + d] += points[i].v[d] * points[i].length;
+    w[best[i]] += points[i].length;
+    clusterInsts[best[i]] += points[i].length;
+  }
+  reps.assign(k, -1);
+  vector<double> repDist(k, 0.0);
+  for(int c = 0; c < k; c++)
+    if(w[c] > 0.0)
+      for(int d = 0; d < DIMS; d++)
+        cent[(size_t)c * DIMS + d] /= w[c];
+  for(int i = 0; i < n; i++) {
+    int c = points[i].cluster;
+    double dd = dist2(points[i].v, &cent[(size_t)c * DIMS], DIMS);
+    if(reps[c] < 0 || dd < repDist[c]) {
+      reps[c] = i;
+      repDist[c] = dd;
+    }
+  }
+}
+
+void SimPoint::simulate(const string &input, vector<Sample> &samples) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  CPU cpu(prog.start, instMem, dataMem);
+  istringstream in(input);
+  ostringstream discard;
+  vector<SampleTimer::Window> windows;
+
+  for(int c = 0; c < k; c++) {
+    if(reps[c] < 0) continue;
+    SampleTimer::Window w;
+    w.start = (long)reps[c] * cfg.interval;
+    w.end = w.start + points[reps[c]].length;
+    w.warm = max(0L, w.start - cfg.warmup);
+    w.slot = c;
+    windows.push_back(w);
+  }
+  sort(windows.begin(), windows.end(), byStart);
+
+  // nothing after the last simulation point needs to be executed
+  long last = 0;
+  for(size_t i = 0; i < windows.size(); i++)
+    last = max(last, windows[i].end);
+
+  SampleTimer timer(windows, k, base);
+  prog.initInstMem(instMem);
+  cpu.setIO(in, discard);
+  cpu.setTraceSink(&timer);
+  cpu.run(last);
+
+  detailed = timer.timed;
+  samples.resize(k);
+  for(int c = 0; c < k; c++) {
+    samples[c].cycles = timer.cycles[c];
+    samples[c].bubbles = timer.bubbles[c];
+    samples[c].flushes = timer.flushes[c];
+    samples[c].length = reps[c] < 0 ? 0 : points[reps[c]].length;
+  }
+}
+
+void SimPoint::report(const vector<Sample> &samples) {
+  double cycles = PIPESTAGES - 1, bubbles = 0.0, flushes = 0.0;
+
+  cout << endl << "SimPoint: " << points.size() << " intervals of " << cfg.interval
+       << " instructions, " << k << " clusters, " << cfg.warmup << " warmup" << endl;
+  cout << "  cluster  weight  interval     CPI" << endl;
+  for(int c = 0; c < k; c++) {
+    if(reps[c] < 0 || samples[c].length == 0) continue;
+    double scale = (double)clusterInsts[c] / samples[c].length;
+    cycles += scale * samples[c].cycles;
+    bubbles += scale * samples[c].bubbles;
+    flushes += scale * samples[c].flushes;
+    cout << "  " << setw(7) << c << "  " << fixed << setprecision(3) << setw(6)
+         << (double)clusterInsts[c] / instructions << "  " << setw(8) << reps[c]
+         << "  " << setprecision(2) << setw(6) << (double)samples[c].cycles / samples[c].length << endl;
+  }
+
+  cout << endl << "Program finished (" << dec << instructions << " instructions executed, "
+       << detailed << " timed in detail)" << endl;
+  RunSummary s;
+  s.instructions = instructions;
+  s.cycles = cycles;
+  s.cpi = cycles / instructions;
+  s.bubbles = bubbles;
+  s.flushes = flushes;
+  s.memops = memops;
+  s.branches = branches;
+  s.taken = taken;
+  printRunSummary(s);
+
+  if(cfg.verify)
+    printEstimateError(cycles, bubbles, flushes, full);
+}
@@ -0,0 +1,67 @@
+#ifndef __SIMPOINT_H
+#define __SIMPOINT_H
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct SimPointConfig {
+  long interval;   // instructions per interval
+  int clusters;    // maximum k for k-means
+  long warmup;     // detailed instructions run ahead of each simulation point
+  bool verify;     // also time the whole run and report the estimate's error
+
+  SimPointConfig() : interval(100000), clusters(10), warmup(1000), verify(false) {}
+};
+
+// SimPoint-style sampled simulation.  A functional pass collects a
+// basic-block vector per fixed-size interval, random-projects it down to
+// DIMS dimensions and clusters the intervals with k-means.  A second pass
+// times only the interval closest to each centroid (plus warmup) and the
+// per-cluster CPI is weighted by how many instructions each cluster covers.
+class SimPoint {
+  public:
+    static const int DIMS = 15;
+
+    SimPoint(const Program &prog, const Stats &base, const SimPointConfig &cfg);
+
+    FAULT run(const string &input);   // guest fault, if one stopped the run
+
+  private:
+    struct Sample {
+      long long cycles, bubbles, flushes;
+      long length;
+    };
+
+    struct Point {
+      double v[DIMS];
+      long length;     // instructions in the interval
+      int cluster;
+    };
+
+    const Program &prog;
+    SimPointConfig cfg;
+
+    vector<Point> points;
+    vector<int> reps;          // representative interval per cluster
+    vector<long> clusterInsts; // instructions covered by each cluster
+    int k;
+
+    long instructions, memops, branches, taken;
+    long detailed;             // instructions run through the timing model
+    Stats base;                // configured, idle model the local ones copy
+    Stats full;                // whole-run timing when verifying
+
+    FAULT profile(const string &input);
+    void cluster();
+    void simulate(const string &input, vector<Sample> &samples);
+    void report(const vector<Sample> &samples);
+};
+
+#endif
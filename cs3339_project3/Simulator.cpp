@@ -8,68 +8,652 @@
  *******************************/
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstdint>
 #include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include "Batch.h"
+#include "Checkpoint.h"
+#include "Daemon.h"
+#include "ForkServer.h"
+#include "ResultCache.h"
 #include "CPU.h"
 #include "Memory.h"
+#include "Program.h"
+#include "MultiTiming.h"
+#include "OoOModel.h"
+#include "IntervalModel.h"
+#include "Memo.h"
+#include "Multicore.h"
+#include "ParallelTiming.h"
+#include "Phase.h"
+#include "SimPoint.h"
+#include "SIMT.h"
+#include "SMT.h"
+#include "Superscalar.h"
+#include "Sweep.h"
+#include "TimeSeries.h"
+#include "Smarts.h"
+#include "Stats.h"
 #include "Debug.h"
 using namespace std;
 
-const int MEMSIZE = 1 << 20; // 2^20
+static int usage(const char *prog) {
+  cerr << "usage: " << prog << " [options] mips_executable" << endl;
+  cerr << "       " << prog << " --batch [--threads N] manifest" << endl;
+  cerr << "       " << prog << " --fork-server SOCKET [options] mips_executable" << endl;
+  cerr << "       " << prog << " --daemon SOCKET [--threads N] [--cache N] [--max-insts N] [--io-timeout S]" << endl;
+  cerr << "       " << prog << " --client SOCKET [options]  (trap input on stdin)" << endl;
+  cerr << "  --cache-dir DIR   replay the output of an identical earlier run (also $SIM_CACHE_DIR)" << endl;
+  cerr << "    --cache-max MB  size limit, least recently used results go first (default 256)" << endl;
+  cerr << "    --no-cache      always simulate" << endl;
+  cerr << "  --fu OP:LAT[:np]  execution latency of add/and/shl/shr/slt/mul/div," << endl;
+  cerr << "                    np = not pipelined (default 1 cycle, pipelined)" << endl;
+  cerr << "  --decoupled       run pipeline timing on a separate thread" << endl;
+  cerr << "  --trace           print each instruction and the register file after it" << endl;
+  cerr << "  --cpi-stack       break the in-order CPI down by stall cause" << endl;
+  cerr << "  --timeseries FILE per-interval counters to FILE (CSV, or raw if *.bin)" << endl;
+  cerr << "    --ts-interval N instructions per row (default 1000000)" << endl;
+  cerr << "  --memo            memoize in-order timing per basic block and pipeline state" << endl;
+  cerr << "  --parallel-timing N  time the in-order pipeline on N threads (exact)" << endl;
+  cerr << "    --pt-chunk N    instructions per chunk (default 262144)" << endl;
+  cerr << "  --profile FILE    per-PC stall/flush profile: top 20 printed, all to FILE (CSV)" << endl;
+  cerr << "  --ooo             also run the out-of-order timing model" << endl;
+  cerr << "    --width N       fetch/issue/commit width (default 4)" << endl;
+  cerr << "    --rob N         reorder buffer entries (default 128)" << endl;
+  cerr << "    --iq N          issue queue entries (default 32)" << endl;
+  cerr << "    --lsq N         load/store queue entries (default 32)" << endl;
+  cerr << "    --mem-ports N   loads/stores issued per cycle (default 2)" << endl;
+  cerr << "    --load-lat N    --mul-lat N  --div-lat N  unit latencies (3, 4, 12)" << endl;
+  cerr << "  --superscalar W   also run the W-wide in-order timing model" << endl;
+  cerr << "    --ss-mem-ports N  loads/stores per cycle (default 1)" << endl;
+  cerr << "    --ss-branches N   branches/jumps per cycle (default 1)" << endl;
+  cerr << "  --multi FILE      also time every pipeline configuration in FILE (JSON) in one pass" << endl;
+  cerr << "  --estimate FILE   analytical CPI of the configurations in FILE (JSON)" << endl;
+  cerr << "  --sweep FILE      time only the configurations in FILE (JSON), one row each" << endl;
+  cerr << "    --threads N     worker threads, also for --batch (default: one per core)" << endl;
+  cerr << "    --sweep-csv F   write the rows to F instead of printing them" << endl;
+  cerr << "    --prune N       time only the N configurations estimated fastest" << endl;
+  cerr << "  --cores N         run N guest cores over one shared data memory" << endl;
+  cerr << "    --quantum Q     instructions per core between sync points (default 1000)" << endl;
+  cerr << "  --smt N           N thread contexts, each running the program, sharing one pipeline" << endl;
+  cerr << "    --smt-policy P  fetch policy: rr, icount or stall (default rr)" << endl;
+  cerr << "    --smt-inputs F  one context per line of F, which is its trap input" << endl;
+  cerr << "  --simt FILE       run one instance per line of FILE (its trap input) in lockstep" << endl;
+  cerr << "                    (--verify: also run them one by one and compare)" << endl;
+  cerr << "  --checkpoints N   functional pass saving a checkpoint every N instructions, then" << endl;
+  cerr << "                    the intervals timed in parallel (--threads, --verify)" << endl;
+  cerr << "  --simpoint        sampled simulation from basic-block vector clusters" << endl;
+  cerr << "    --interval N    instructions per interval (default 100000)" << endl;
+  cerr << "    --clusters K    maximum number of clusters (default 10)" << endl;
+  cerr << "  --smarts          periodic sampling with a CPI confidence interval" << endl;
+  cerr << "    --period N      instructions between samples (default 10000)" << endl;
+  cerr << "    --window N      instructions measured per sample (default 1000)" << endl;
+  cerr << "    --target E      relative CI half-width to report reaching (default 0.01)" << endl;
+  cerr << "  --phases          skip timing of recurring phases with a stable CPI" << endl;
+  cerr << "    --phase-interval N  instructions per classification interval (default 10000)" << endl;
+  cerr << "    --phase-threshold D max signature distance within a phase (default 0.3)" << endl;
+  cerr << "  sampling options:" << endl;
+  cerr << "    --warmup N      detailed warmup before each sample (default 1000 / 16)" << endl;
+  cerr << "    --verify        also run full timing and report the estimate's error" << endl;
+  return -1;
+}
 
-int main(int argc, char *argv[]) {
-  int count, start;
-  ifstream exeFile;
-  uint8_t bytes[4];
+// The in-order report: final stats, CPI stack and per-PC profile
+template<class C>
+static void printReport(C &cpu, Stats &stats, bool cpiStack, PCProfile &profile, const char *profileFile) {
+  cout << endl;
+  cpu.printFinalStats();
+  if(cpiStack) stats.printCPIStack(cpu.getInstructions());
+  if(profileFile) {
+    profile.printReport(20);
+    profile.writeCSV(profileFile);
+  }
+}
+
+// Runs the program on a configuration C fixed at compile time, with
+// nothing but stats timing it
+template<class C>
+static int runFixed(const Program &prog, Stats &stats, bool cpiStack, PCProfile &profile, const char *profileFile) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  C cpu(prog.start, instMem, dataMem);
+
+  cpu.setStats(stats);
+  prog.initInstMem(instMem);
+  if(cpu.run() != FAULT_NONE)
+    return -1;
+  printReport(cpu, stats, cpiStack, profile, profileFile);
+  return 0;
+}
+
+// set by the fork server, whose children all run the same program
+static const Program *preloaded = NULL;
+
+static int simulate(int argc, char *argv[]) {
+  const char *simtFile = NULL, *smtInputs = NULL;
+  const char *profileFile = NULL, *seriesFile = NULL, *multiFile = NULL, *sweepFile = NULL, *estimateFile = NULL;
+  long prune = 0;
+  int smtThreads = 0;   // set by --smt
+  long long seriesInterval = 1000000;
+  bool decoupled = false, trace = false, cpiStack = false, ooo = false, superscalar = false, simpoint = false, smarts = false;
+  OoOConfig oooCfg;
+  SuperscalarConfig ssCfg;
+  FUConfig fuCfg;
+  Stats stats;   // in-order pipeline timing
+  SimPointConfig spCfg;
+  SmartsConfig smCfg;
+  PhaseConfig phCfg;
+  ParallelTimingConfig ptCfg;
+  SweepConfig swCfg;
+  MulticoreConfig mcCfg;
+  SMTConfig smtCfg;
+  CheckpointConfig ckCfg;
+  bool phases = false, memo = false, parallel = false, batch = false, multicore = false, smt = false, checkpoints = false;
+  Program prog;
 
   cout << "CS 3339 MIPS Simulator" << endl;
-  if(argc != 2) {
-    cerr << "usage: " << argv[0] << " mips_executable" << endl;
+  if(argc < 2)
+    return usage(argv[0]);
+  for(int i = 1; i < argc - 1; i++) {
+    bool hasArg = i + 1 < argc - 1;
+    if(!strcmp(argv[i], "--decoupled"))
+      decoupled = true;
+    else if(!strcmp(argv[i], "--trace"))
+      trace = true;
+    else if(!strcmp(argv[i], "--cpi-stack"))
+      cpiStack = true;
+    else if(!strcmp(argv[i], "--timeseries") && hasArg)
+      seriesFile = argv[++i];
+    else if(!strcmp(argv[i], "--ts-interval") && hasArg)
+      seriesInterval = atoll(argv[++i]);
+    else if(!strcmp(argv[i], "--memo"))
+      memo = true;
+    else if(!strcmp(argv[i], "--parallel-timing") && hasArg) {
+      parallel = true;
+      ptCfg.threads = atoi(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "--pt-chunk") && hasArg)
+      ptCfg.chunk = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--profile") && hasArg)
+      profileFile = argv[++i];
+    else if(!strcmp(argv[i], "--fu") && hasArg) {
+      if(!parseFUSpec(argv[++i], fuCfg))
+        return usage(argv[0]);
+    }
+    else if(!strcmp(argv[i], "--ooo"))
+      ooo = true;
+    else if(!strcmp(argv[i], "--width") && hasArg)
+      oooCfg.width = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--rob") && hasArg)
+      oooCfg.robSize = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--iq") && hasArg)
+      oooCfg.iqSize = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--lsq") && hasArg)
+      oooCfg.lsqSize = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--mem-ports") && hasArg)
+      oooCfg.memPorts = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--load-lat") && hasArg)
+      oooCfg.loadLat = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--mul-lat") && hasArg)
+      oooCfg.mulLat = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--div-lat") && hasArg)
+      oooCfg.divLat = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--superscalar") && hasArg) {
+      superscalar = true;
+      ssCfg.width = atoi(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "--ss-mem-ports") && hasArg)
+      ssCfg.memPorts = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--ss-branches") && hasArg)
+      ssCfg.branches = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--multi") && hasArg)
+      multiFile = argv[++i];
+    else if(!strcmp(argv[i], "--batch"))
+      batch = true;
+    else if(!strcmp(argv[i], "--sweep") && hasArg)
+      sweepFile = argv[++i];
+    else if(!strcmp(argv[i], "--threads") && hasArg)
+      swCfg.threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--sweep-csv") && hasArg)
+      swCfg.csvFile = argv[++i];
+    else if(!strcmp(argv[i], "--prune") && hasArg)
+      prune = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--estimate") && hasArg)
+      estimateFile = argv[++i];
+    else if(!strcmp(argv[i], "--cores") && hasArg) {
+      multicore = true;
+      mcCfg.cores = atoi(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "--quantum") && hasArg)
+      mcCfg.quantum = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--smt") && hasArg) {
+      smt = true;
+      smtCfg.threads = smtThreads = atoi(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "--smt-policy") && hasArg) {
+      if(!parseSMTPolicy(argv[++i], smtCfg.policy))
+        return usage(argv[0]);
+    }
+    else if(!strcmp(argv[i], "--smt-inputs") && hasArg) {
+      smt = true;
+      smtInputs = argv[++i];
+    }
+    else if(!strcmp(argv[i], "--simt") && hasArg)
+      simtFile = argv[++i];
+    else if(!strcmp(argv[i], "--checkpoints") && hasArg) {
+      checkpoints = true;
+      ckCfg.interval = atol(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "--simpoint"))
+      simpoint = true;
+    else if(!strcmp(argv[i], "--interval") && hasArg)
+      spCfg.interval = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--clusters") && hasArg)
+      spCfg.clusters = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--smarts"))
+      smarts = true;
+    else if(!strcmp(argv[i], "--period") && hasArg)
+      smCfg.period = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--window") && hasArg)
+      smCfg.window = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--target") && hasArg)
+      smCfg.target = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--phases"))
+      phases = true;
+    else if(!strcmp(argv[i], "--phase-interval") && hasArg)
+      phCfg.interval = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--phase-threshold") && hasArg)
+      phCfg.threshold = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--warmup") && hasArg)
+      spCfg.warmup = smCfg.warmup = atol(argv[++i]);
+    else if(!strcmp(argv[i], "--verify"))
+      spCfg.verify = smCfg.verify = phCfg.verify = true;
+    else
+      return usage(argv[0]);
+  }
+  if(spCfg.interval <= 0 || spCfg.clusters <= 0 || spCfg.warmup < 0)
+    return usage(argv[0]);
+  if(oooCfg.width <= 0 || oooCfg.robSize <= 0 || oooCfg.iqSize <= 0 || oooCfg.lsqSize <= 0 ||
+     oooCfg.memPorts <= 0 || oooCfg.loadLat <= 0 || oooCfg.mulLat <= 0 || oooCfg.divLat <= 0)
+    return usage(argv[0]);
+  if(seriesInterval <= 0)
+    return usage(argv[0]);
+  if(swCfg.threads <= 0 || prune < 0)
+    return usage(argv[0]);
+  if(ptCfg.threads <= 0 || ptCfg.chunk <= ptCfg.warm)
+    return usage(argv[0]);
+  if(parallel && (memo || seriesFile)) {
+    cerr << "--parallel-timing cannot be combined with --memo or --timeseries" << endl;
     return -1;
   }
-
-  // open executable
-  exeFile.open(argv[1], ios::binary | ios::in);
-  if(!exeFile) {
-    cerr << "error: could not open executable file " << argv[1] << endl;
+  if(trace && (decoupled || memo || parallel || seriesFile || ooo || superscalar || multiFile)) {
+    cerr << "--trace runs the in-order pipeline only, without other timing models" << endl;
     return -1;
   }
+  if(ssCfg.width <= 0 || ssCfg.width > 64 || ssCfg.memPorts <= 0 || ssCfg.branches <= 0)
+    return usage(argv[0]);
+  if(phCfg.interval <= PhaseSim::WARM || phCfg.threshold < 0.0)
+    return usage(argv[0]);
+  if(mcCfg.cores <= 0 || mcCfg.cores > 32 || mcCfg.quantum <= 0)
+    return usage(argv[0]);
+  if(ckCfg.interval <= 0)
+    return usage(argv[0]);
+  if(smtCfg.threads <= 0 || smtCfg.threads > 64)
+    return usage(argv[0]);
+  if(batch + simpoint + smarts + phases + multicore + smt + checkpoints +
+     (simtFile != NULL) + (sweepFile != NULL) + (estimateFile != NULL) > 1) {
+    cerr << "--batch, --simpoint, --estimate, --sweep, --smarts, --phases, --cores, --checkpoints," << endl
+         << "--simt and --smt each select a different simulation, pick one" << endl;
+    return usage(argv[0]);
+  }
+  if(smarts && (smCfg.window <= 0 || smCfg.warmup < 0 || smCfg.window + smCfg.warmup > smCfg.period))
+    return usage(argv[0]);
 
-  // BE->LE swap: Executable files are stored 0A0B0C0D => addr 00,01,02,03
-  //              Read into bytes[] as b[0],b[1],b[2],b[3] = 0A,0B,0C,0D
-  //              Need to swizzle bytes back into little-endian
-  
-  // read # of words in file
-  if(!exeFile.read((char *)&bytes, 4)) {
-    cerr << "error: could not read count from file " << argv[1] << endl;
-    return -1;
+  if(batch) {
+    // the last argument is the manifest rather than a program
+    Batch b(swCfg.threads);
+    if(!b.load(argv[argc - 1]))
+      return -1;
+    b.run();
+    return 0;
   }
-  count = Memory::swizzle(bytes);
 
-  // read start address from file
-  if(!exeFile.read((char *)&bytes, 4)) {
-    cerr << "error: could not read start addr from file " << argv[1] << endl;
+  if(preloaded && preloaded->name == argv[argc - 1])
+    prog = *preloaded;
+  else if(!prog.load(argv[argc - 1]))
+    return -1;
+  vector<PipeConfig> pipeCfgs;
+  if(multiFile && !loadPipeConfigs(multiFile, pipeCfgs))
     return -1;
+  vector<PipeConfig> sweepCfgs;
+  if(sweepFile && !loadPipeConfigs(sweepFile, sweepCfgs))
+    return -1;
+  vector<PipeConfig> estimateCfgs;
+  if(estimateFile && !loadPipeConfigs(estimateFile, estimateCfgs))
+    return -1;
+  stats.setFU(fuCfg);
+
+  cout << "Running: " << prog.name << endl << endl;
+
+  if(simpoint) {
+    // both passes replay the same trap input
+    ostringstream input;
+    input << cin.rdbuf();
+    SimPoint sp(prog, stats, spCfg);
+    return sp.run(input.str()) == FAULT_NONE ? 0 : -1;
+  }
+
+  if(estimateFile) {
+    IntervalModel im;
+    MultiTiming detailed(estimateCfgs);
+    if(im.run(prog, cin, cout, spCfg.verify ? &detailed : NULL) != FAULT_NONE)
+      return -1;
+    im.printReport(estimateCfgs, spCfg.verify ? &detailed : NULL);
+    return 0;
+  }
+
+  if(sweepFile) {
+    if(prune && (size_t)prune < sweepCfgs.size()) {
+      // profile once, then time only the most promising configurations
+      ostringstream input;
+      ostringstream discard;
+      input << cin.rdbuf();
+      istringstream profileIn(input.str()), sweepIn(input.str());
+      IntervalModel im;
+      if(im.run(prog, profileIn, discard) != FAULT_NONE)
+        return -1;
+      im.prune(sweepCfgs, prune);
+      cout << "Pruned to the " << prune << " configurations with the lowest estimated CPI" << endl;
+      Sweep sw(prog, sweepCfgs, swCfg);
+      return sw.run(sweepIn, cout) == FAULT_NONE ? 0 : -1;
+    }
+    Sweep sw(prog, sweepCfgs, swCfg);
+    return sw.run(cin, cout) == FAULT_NONE ? 0 : -1;
+  }
+
+  if(smarts) {
+    Smarts sm(prog, stats, smCfg);
+    return sm.run(cin, cout) == FAULT_NONE ? 0 : -1;
+  }
+
+  if(phases) {
+    PhaseSim ps(prog, stats, phCfg);
+    return ps.run(cin, cout) == FAULT_NONE ? 0 : -1;
+  }
+
+  if(multicore) {
+    // every core reads the same trap input
+    ostringstream input;
+    input << cin.rdbuf();
+    Multicore mc(prog, mcCfg, stats);
+    return mc.run(input.str(), cout) == FAULT_NONE ? 0 : -1;
+  }
+
+  if(checkpoints) {
+    ostringstream input;
+    input << cin.rdbuf();
+    ckCfg.threads = swCfg.threads;
+    ckCfg.verify = spCfg.verify;
+    CheckpointSim cs(prog, stats, ckCfg);
+    return cs.run(input.str(), cout) == FAULT_NONE ? 0 : -1;
+  }
+
+  if(simtFile) {
+    ifstream f(simtFile);
+    if(!f) {
+      cerr << "error: could not open " << simtFile << endl;
+      return -1;
+    }
+    vector<string> inputs;
+    string line;
+    while(getline(f, line))
+      inputs.push_back(line);
+    SIMTEngine simt(prog, inputs);
+    bool ok = simt.run();
+    simt.report(cout, spCfg.verify);
+    return ok ? 0 : -1;
+  }
+
+  if(smt) {
+    vector<string> inputs;
+    if(smtInputs) {
+      // one context per line, unless --smt asked for a different number
+      ifstream f(smtInputs);
+      string line;
+      if(!f) {
+        cerr << "error: could not open " << smtInputs << endl;
+        return -1;
+      }
+      while(getline(f, line))
+        inputs.push_back(line);
+      if(inputs.empty() || inputs.size() > 64 || (smtThreads && smtThreads != (int)inputs.size())) {
+        cerr << smtInputs << " has " << inputs.size() << " lines, need one per context (at most 64)" << endl;
+        return -1;
+      }
+      smtCfg.threads = inputs.size();
+    }
+    else {
+      // every context reads the same trap input
+      ostringstream input;
+      input << cin.rdbuf();
+      inputs.assign(smtCfg.threads, input.str());
+    }
+    SMTModel model(prog, smtCfg, stats);
+    return model.run(inputs, cout) == FAULT_NONE ? 0 : -1;
+  }
+
+  PCProfile profile(prog.instMemBytes() >> 2);
+  if(profileFile) stats.setProfile(&profile);
+  if((memo || parallel) && !stats.isMemoizable()) {
+    cerr << (memo ? "--memo" : "--parallel-timing")
+         << " needs single-cycle units and no --profile, timing every instruction" << endl;
+    memo = parallel = false;
+  }
+
+  // only stats: the CPU feeds it directly
+  if(!(decoupled || memo || parallel || seriesFile || ooo || superscalar || multiFile)) {
+    if(trace)
+      return runFixed<TracedCPU>(prog, stats, cpiStack, profile, profileFile);
+    return runFixed<PipelineCPU>(prog, stats, cpiStack, profile, profileFile);
   }
-  start = Memory::swizzle(bytes);
 
   // Memories
-  Memory instMem(count << 4, 0x400000, false); // 4 bytes per inst
-  Memory dataMem(MEMSIZE, 0x10000000, true);
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
 
   // CPU
-  CPU cpu(start, instMem, dataMem);
+  CPU cpu(prog.start, instMem, dataMem);
+  cpu.setStats(stats);
 
   // initialize the instruction memory
-  instMem.initFromExe(exeFile, count);
-  exeFile.close();
+  prog.initInstMem(instMem);
+
+  // timing models fed from the instruction stream
+  TraceFanout timing;
+  TimingMemo timingMemo(stats);
+  ParallelTiming parTiming(stats, ptCfg);
+  OoOModel oooModel(oooCfg);
+  SuperscalarModel ssModel(ssCfg);
+  MultiTiming multiModel(pipeCfgs);
+  TimeSeries series(stats, seriesInterval);
+  if(seriesFile && !series.open(seriesFile))
+    return -1;
+  if(memo) timing.add(&timingMemo);
+  else if(parallel) timing.add(&parTiming);
+  else timing.add(&stats);
+  if(seriesFile) timing.add(&series);
+  if(ooo) timing.add(&oooModel);
+  if(superscalar) timing.add(&ssModel);
+  if(multiFile) timing.add(&multiModel);
 
-  cout << "Running: " << argv[1] << endl << endl;
-  cpu.run();
+  FAULT fault;
+  if(decoupled) {
+    // functional model on this thread, timing models on another
+    TraceRing *ring = TraceRing::create();
+    if(!ring) {
+      cerr << "error: out of memory" << endl;
+      return -1;
+    }
+    RingSink sink(*ring);
+    thread timingThread([ring, &timing] {
+      while(ring->consume([&timing](const InstRecord &rec) { timing.consume(rec); }));
+    });
+    cpu.setTraceSink(&sink);
+    fault = cpu.run();
+    ring->close();
+    timingThread.join();
+    TraceRing::destroy(ring);
+  }
+  else {
+    cpu.setTraceSink(&timing);
+    fault = cpu.run();
+  }
+  if(fault != FAULT_NONE)
+    return -1;
 
   // Finish-up stats
-  cout << endl;
-  cpu.printFinalStats();
+  if(memo) timingMemo.finish();
+  if(parallel) parTiming.finish();
+  series.finish();
+  printReport(cpu, stats, cpiStack, profile, profileFile);
+  if(memo) timingMemo.printFinalStats();
+  if(parallel) parTiming.printFinalStats();
+  if(ooo) oooModel.printFinalStats();
+  if(superscalar) ssModel.printFinalStats();
+  if(multiFile) multiModel.printFinalStats();
 
   return 0;
 }
+
+// Runs simulate() through the result cache.  The key covers the simulator
+// executable (standing in for its version), the options, the program and
+// any configuration files it names, and the trap input.
+static int cachedSimulate(const char *dir, long long maxBytes, int argc, char *argv[]) {
+  ContentHash key;
+  string contents;
+
+  // interactive input can't be hashed up front
+  if(isatty(0))
+    return simulate(argc, argv);
+  if(!readFile("/proc/self/exe", contents) && !readFile(argv[0], contents))
+    return simulate(argc, argv);
+  key.add(contents);
+  if(!readFile(argv[argc - 1], contents))
+    return simulate(argc, argv);   // reports the error
+  key.add(contents);
+
+  for(int i = 1; i < argc; i++) {
+    key.add(argv[i]);
+    // a replay would skip writing these files
+    if(!strcmp(argv[i], "--profile") || !strcmp(argv[i], "--timeseries") ||
+       !strcmp(argv[i], "--sweep-csv") || !strcmp(argv[i], "--batch"))
+      return simulate(argc, argv);
+    // these report measured host time, which a replay would pass off as current
+    if(!strcmp(argv[i], "--phases") || !strcmp(argv[i], "--smt") || !strcmp(argv[i], "--smt-inputs") ||
+       !strcmp(argv[i], "--simt") || !strcmp(argv[i], "--checkpoints") || !strcmp(argv[i], "--sweep") ||
+       !strcmp(argv[i], "--cores") || !strcmp(argv[i], "--estimate"))
+      return simulate(argc, argv);
+    // the only input file a cached run can read besides the program
+    if(!strcmp(argv[i], "--multi") && i + 1 < argc - 1) {
+      if(!readFile(argv[i + 1], contents))
+        return simulate(argc, argv);
+      key.add(contents);
+    }
+  }
+
+  ostringstream input;
+  input << cin.rdbuf();
+  key.add(input.str());
+
+  ResultCache cache(dir, maxBytes);
+  string output;
+  if(cache.lookup(key.hex(), output)) {
+    cout << output;
+    return 0;
+  }
+
+  istringstream replay(input.str());
+  streambuf *stdinBuf = cin.rdbuf(replay.rdbuf());
+  int rc;
+  bool warned;
+  {
+    OutputCapture capture, errors(cerr);
+    rc = simulate(argc, argv);
+    output = capture.str();
+    warned = !errors.str().empty();
+  }
+  cin.rdbuf(stdinBuf);
+  // failed runs and runs with messages on stderr are not cached, so
+  // their errors and warnings show again
+  if(rc == 0 && !warned)
+    cache.store(key.hex(), output);
+  return rc;
+}
+
+int main(int argc, char *argv[]) {
+  if(argc >= 3 && !strcmp(argv[1], "--client"))
+    return forkClient(argv[2], argc - 3, argv + 3);
+
+  if(argc >= 3 && !strcmp(argv[1], "--daemon")) {
+    DaemonConfig dCfg;
+    for(int i = 3; i < argc; i++) {
+      if(!strcmp(argv[i], "--threads") && i + 1 < argc)
+        dCfg.threads = atoi(argv[++i]);
+      else if(!strcmp(argv[i], "--cache") && i + 1 < argc)
+        dCfg.cacheSize = atoi(argv[++i]);
+      else if(!strcmp(argv[i], "--max-insts") && i + 1 < argc)
+        dCfg.maxInstructions = atoll(argv[++i]);
+      else if(!strcmp(argv[i], "--io-timeout") && i + 1 < argc)
+        dCfg.ioTimeout = atoi(argv[++i]);
+      else
+        return usage(argv[0]);
+    }
+    if(dCfg.threads <= 0 || dCfg.cacheSize <= 0 || dCfg.maxInstructions < 0 || dCfg.ioTimeout <= 0)
+      return usage(argv[0]);
+    Daemon d(argv[2], dCfg);
+    return d.serve();
+  }
+
+  if(argc >= 4 && !strcmp(argv[1], "--fork-server")) {
+    // load the program once; every request runs in a fork of this process
+    static Program image;
+    if(!image.load(argv[argc - 1]))
+      return -1;
+    preloaded = &image;
+
+    vector<string> base;
+    base.push_back(argv[0]);
+    for(int i = 3; i < argc; i++)
+      base.push_back(argv[i]);
+    ForkServer server(argv[2], base, simulate);
+    return server.serve();
+  }
+
+  // the result cache options are handled here, simulate() never sees them
+  const char *cacheDir = getenv("SIM_CACHE_DIR");
+  long long cacheMax = 256;
+  bool noCache = false;
+  vector<char *> args;
+  for(int i = 0; i < argc; i++) {
+    if(i > 0 && !strcmp(argv[i], "--no-cache"))
+      noCache = true;
+    else if(i > 0 && !strcmp(argv[i], "--cache-dir") && i + 1 < argc)
+      cacheDir = argv[++i];
+    else if(i > 0 && !strcmp(argv[i], "--cache-max") && i + 1 < argc)
+      cacheMax = atoll(argv[++i]);
+    else
+      args.push_back(argv[i]);
+  }
+  args.push_back(NULL);
+  int n = args.size() - 1;
+
+  if(noCache || !cacheDir || !*cacheDir || n < 2)
+    return simulate(n, args.data());
+  if(cacheMax <= 0)
+    return usage(argv[0]);
+  return cachedSimulate(cacheDir, cacheMax << 20, n, args.data());
+}
@@ -0,0 +1,113 @@
+/*
+ * SMARTS-style periodic sampling with confidence intervals.  There are no
+ * caches or predictors to keep functionally warm, so the only timing state
+ * is the Stats pipeline, which a short detailed warmup rebuilds exactly.
+ */
+
+#include <cmath>
+#include <sstream>
+#include "Smarts.h"
+#include "CPU.h"
+#include "Memory.h"
+
+Smarts::Smarts(const Program &prog, const Stats &base, const SmartsConfig &cfg)
+    : prog(prog), cfg(cfg), timing(base), full(base) {
+  n = 0;
+  memops = branches = taken = 0;
+  c0 = b0 = f0 = 0;
+  samples = 0;
+  sumCpi = sumCpi2 = sumBpi = sumFpi = 0.0;
+  reachedAt = 0;
+}
+
+FAULT Smarts::run(istream &in, ostream &out) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  CPU cpu(prog.start, instMem, dataMem);
+
+  prog.initInstMem(instMem);
+  cpu.setIO(in, out);
+  cpu.setTraceSink(this);
+  if(cpu.run() != FAULT_NONE)
+    return cpu.getFault();
+
+  report(cpu.getInstructions());
+  return FAULT_NONE;
+}
+
+void Smarts::consume(const InstRecord &rec) {
+  if(rec.flags & (REC_LOAD | REC_STORE)) memops++;
+  if(rec.flags & REC_BRANCH) branches++;
+  if(rec.flags & REC_TAKEN) taken++;
+  if(cfg.verify) full.process(rec);
+
+  // each period ends with warmup + window instructions of detailed timing
+  long pos = n % cfg.period;
+  long warmStart = cfg.period - cfg.window - cfg.warmup;
+  long winStart = cfg.period - cfg.window;
+
+  if(pos >= warmStart) {
+    if(pos == winStart) {
+      c0 = timing.getCycles();
+      b0 = timing.getBubbles();
+      f0 = timing.getFlushes();
+    }
+    timing.process(rec);
+    if(pos == cfg.period - 1) {
+      double cpi = (double)(timing.getCycles() - c0) / cfg.window;
+      samples++;
+      sumCpi += cpi;
+      sumCpi2 += cpi * cpi;
+      sumBpi += (double)(timing.getBubbles() - b0) / cfg.window;
+      sumFpi += (double)(timing.getFlushes() - f0) / cfg.window;
+      if(!reachedAt && samples >= cfg.minSamples && halfWidth() <= cfg.target * sumCpi / samples)
+        reachedAt = n + 1;
+    }
+  }
+  n++;
+}
+
+// 95% confidence interval half-width of the mean CPI
+double Smarts::halfWidth() const {
+  if(samples < 2) return 0.0;
+  double mean = sumCpi / samples;
+  double var = (sumCpi2 - samples * mean * mean) / (samples - 1);
+  return 1.96 * sqrt(var > 0.0 ? var / samples : 0.0);
+}
+
+void Smarts::report(long instructions) {
+  if(samples == 0) {
+    cout << endl << "SMARTS: program too short for one " << cfg.period
+         << "-instruction sampling period" << endl;
+    return;
+  }
+
+  RunSummary s;
+  ostringstream note;
+  s.instructions = instructions;
+  s.cpi = sumCpi / samples;
+  s.cycles = PIPESTAGES - 1 + s.cpi * instructions;
+  s.bubbles = sumBpi / samples * instructions;
+  s.flushes = sumFpi / samples * instructions;
+  s.memops = memops;
+  s.branches = branches;
+  s.taken = taken;
+  note << " +/- " << fixed << setprecision(3) << halfWidth() << " (95% confidence)";
+  s.cpiNote = note.str();
+
+  cout << endl << "SMARTS: " << samples << " samples of " << cfg.window << " instructions every "
+       << cfg.period << ", " << cfg.warmup << " warmup" << endl;
+  if(reachedAt)
+    cout << "  target error " << fixed << setprecision(1) << 100.0 * cfg.target
+         << "% reached after " << reachedAt << " instructions" << endl;
+  else
+    cout << "  target error " << fixed << setprecision(1) << 100.0 * cfg.target
+         << "% not reached" << endl;
+
+  cout << endl << "Program finished (" << dec << instructions << " instructions executed, "
+       << (long)samples * (cfg.window + cfg.warmup) << " timed in detail)" << endl;
+  printRunSummary(s);
+
+  if(cfg.verify)
+    printEstimateError(s.cycles, s.bubbles, s.flushes, full);
+}
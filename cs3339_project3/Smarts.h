@@ -0,0 +1,57 @@
+#ifndef __SMARTS_H
+#define __SMARTS_H
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include "Program.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct SmartsConfig {
+  long period;     // instructions between the starts of two samples
+  long window;     // instructions measured per sample
+  long warmup;     // detailed instructions run before each window
+  double target;   // report when the CI half-width / CPI first falls below this
+  int minSamples;  // never count the target as reached before this many samples
+  bool verify;     // also time the whole run and report the estimate's error
+
+  SmartsConfig() : period(10000), window(1000), warmup(2 * PIPESTAGES), target(0.01),
+                   minSamples(30), verify(false) {}
+};
+
+// SMARTS-style systematic sampling.  The program runs functionally and
+// every period instructions the timing model is switched on for a short
+// detailed warmup followed by a measured window.  The per-window CPIs give
+// a mean and a 95% confidence interval.  Sampling keeps its stride to the
+// end of the run so the estimate covers every phase, not just a prefix;
+// the report notes when the interval first became tight enough.
+class Smarts : public TraceSink {
+  public:
+    Smarts(const Program &prog, const Stats &base, const SmartsConfig &cfg);
+
+    FAULT run(istream &in, ostream &out);   // guest fault, if one stopped the run
+    void consume(const InstRecord &rec);
+
+  private:
+    const Program &prog;
+    SmartsConfig cfg;
+
+    Stats timing;
+    Stats full;               // whole-run timing when verifying
+    long n;                   // instructions seen
+    long memops, branches, taken;
+    long long c0, b0, f0;
+
+    // running sums over completed windows (per-instruction rates)
+    int samples;
+    double sumCpi, sumCpi2, sumBpi, sumFpi;
+    long reachedAt;           // instructions run when the target was first met
+
+    double halfWidth() const;
+    void report(long instructions);
+};
+
+#endif
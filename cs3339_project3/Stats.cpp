@@ -10,6 +10,9 @@
  * Texas State University.
  ******************************/
  
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
 #include "Stats.h"
 
 Stats::Stats() {
@@ -23,18 +26,42 @@ Stats::Stats() {
 
   for(int i = IF1; i < PIPESTAGES; i++) {
     resultReg[i] = -1;
+    resultInfo[i] = 0;
+  }
+  profile = NULL;
+  curIndex = 0;
+  for(int i = 0; i < STALL_CAUSES; i++) {
+    stalls[i] = 0;
+  }
+
+  fuActive = false;
+  for(int i = 0; i < 33; i++) {
+    fuReady[i] = 0;
+    fuSource[i] = ADD;
+    fuProducer[i] = 0;
+  }
+  for(int i = 0; i < ALU_OPS; i++) {
+    unitFree[i] = 0;
+    fuDataStalls[i] = 0;
+    fuBusyStalls[i] = 0;
   }
 }
 
 void Stats::clock() {
   cycles++;
 
-  // advance all stages in pipeline
-  for(int i = WB; i > IF1; i--) {
+  // advance all stages in pipeline, inject a NOP in pipestage IF1
+  advance(IF1);
+}
+
+// shifts stages from..WB down by one and puts a NOP in stage from
+void Stats::advance(int from) {
+  for(int i = WB; i > from; i--) {
     resultReg[i] = resultReg[i-1];
+    resultInfo[i] = resultInfo[i-1];
   }
-  // inject a NOP in pipestage IF1
-  resultReg[IF1] = -1;
+  resultReg[from] = -1;
+  resultInfo[from] = 0;
 }
 
 void Stats::registerSrc(int r) { // r == register being read
@@ -44,38 +71,238 @@ void Stats::registerSrc(int r) { // r == register being read
     else {
         for (int i = EXE1; i < WB; i++) {
             if (resultReg[i] == r) {
+                STALL cause = r == 32 ? STALL_HILO : (resultInfo[i] & 1) ? STALL_RAW_LOAD : STALL_RAW_ALU;
+                if (profile) {
+                    profile->consumerBubbles[curIndex] += WB - i;
+                    profile->producerBubbles[resultInfo[i] >> 1] += WB - i;
+                }
                 for (int j = i; j < WB; j++) {
-                    bubble();
+                    bubble(cause);
                 }
+                break;
             }
         }
     }
 }
 
-void Stats::registerDest(int r) { // r == register to be written to
+void Stats::registerDest(int r, bool isLoad) { // r == register to be written to
     resultReg[ID] = r;
+    resultInfo[ID] = curIndex << 1 | (isLoad ? 1 : 0);
 }
 
-void Stats::flush(int count) { // count == how many ops to flush
+// --fu op:latency[:np]  e.g. div:12:np for an unpipelined 12-cycle divider
+bool parseFUSpec(const char *arg, FUConfig &fu) {
+    static const char *names[ALU_OPS] = { "add", "and", "shl", "shr", "slt", "mul", "div" };
+    const char *colon = strchr(arg, ':');
+    if(!colon) return false;
+
+    for(int op = 0; op < ALU_OPS; op++) {
+      if(strncmp(arg, names[op], colon - arg) || strlen(names[op]) != (size_t)(colon - arg))
+        continue;
+      char *end;
+      long lat = strtol(colon + 1, &end, 10);
+      if(lat <= 0 || (*end && strcmp(end, ":np"))) return false;
+      fu.latency[op] = lat;
+      fu.pipelined[op] = *end == '\0';
+      return true;
+    }
+    return false;
+}
+
+void Stats::setFU(const FUConfig &cfg) {
+    fu = cfg;
+    fuActive = false;
+    for (int i = 0; i < ALU_OPS; i++)
+        fuActive = fuActive || fu.latency[i] > 1;
+}
+
+// Called once the instruction in ID is free of data hazards: waits for a
+// busy unpipelined unit, then records when a multi-cycle result is ready.
+void Stats::registerUnit(int op, int dest) {
+    while (cycles < unitFree[op]) {
+        bubble(STALL_STRUCT);
+        fuBusyStalls[op]++;
+        if (profile) profile->consumerBubbles[curIndex]++;
+    }
+    unitFree[op] = cycles + (fu.pipelined[op] ? 1 : fu.latency[op]);
+
+    if (dest > 0) {
+        fuReady[dest] = cycles + (WB - ID) + fu.latency[op] - 1;
+        fuSource[dest] = op;
+        fuProducer[dest] = curIndex;
+    }
+}
+
+void Stats::flush(int count, STALL cause) { // count == how many ops to flush
     for (int i = 0; i < count; i++) {
         cycles++;
         flushes++;
+        stalls[cause]++;
+
+        advance(IF1);
+    }
+}
 
-        for (int i = WB; i > IF1; i--) {
-            resultReg[i] = resultReg[i - 1];
+// Advances the pipeline by one instruction described by rec.  This is the
+// only entry point the timing thread uses, so all hazard bookkeeping for
+// an instruction happens here in the same order decode() used to do it.
+void Stats::process(const InstRecord &rec) {
+    curIndex = PCProfile::index(rec.pc);
+    if (profile) profile->count[curIndex]++;
+
+    clock();
+
+    if (rec.dest >= 0) registerDest(rec.dest, rec.flags & REC_LOAD);
+    if (rec.src[0] >= 0) registerSrc(rec.src[0]);
+    if (rec.src[1] >= 0) registerSrc(rec.src[1]);
+
+    // results still in a multi-cycle unit
+    if (fuActive) {
+        for (int s = 0; s < 2; s++) {
+            int r = rec.src[s];
+            if (r > 0) {
+                while (cycles < fuReady[r]) {
+                    bubble(r == 32 ? STALL_HILO : STALL_RAW_ALU);
+                    fuDataStalls[fuSource[r]]++;
+                    if (profile) {
+                        profile->consumerBubbles[curIndex]++;
+                        profile->producerBubbles[fuProducer[r]]++;
+                    }
+                }
+            }
         }
-        resultReg[i]=-1;
+        if (rec.aluOp < ALU_OPS)
+            registerUnit(rec.aluOp, rec.dest);
+        else if (rec.dest > 0)
+            fuReady[rec.dest] = 0;   // jal and trap input write without a unit
+    }
+
+    if (rec.flags & (REC_LOAD | REC_STORE)) countMemOp();
+    if (rec.flags & REC_BRANCH) countBranch();
+    if (rec.flags & REC_TAKEN) countTaken();
+
+    if (profile && (rec.flags & (REC_TAKEN | REC_JUMP | REC_JR)))
+        profile->flushes[curIndex] += 2;
+    if (rec.flags & REC_TAKEN) flush(2, STALL_BRANCH);
+    else if (rec.flags & REC_JUMP) flush(2, STALL_JUMP);
+    else if (rec.flags & REC_JR) flush(2, STALL_JR);
+}
+
+// Between instructions IF1 and IF2 always hold NOPs, so the pipeline is
+// fully described by the registers (and load bits) in ID..MEM2; WB is
+// never looked at again.  7 bits per stage, 35 bits in all.
+uint64_t Stats::getPipeState() const {
+    uint64_t state = 0;
+    for (int i = ID; i < WB; i++)
+        state = state << 7 | (uint64_t)(resultReg[i] + 1) << 1 | (resultInfo[i] & 1);
+    return state;
+}
+
+void Stats::setPipeState(uint64_t state) {
+    for (int i = WB - 1; i >= ID; i--) {
+        resultInfo[i] = state & 1;
+        resultReg[i] = (int)((state >> 1) & 0x3f) - 1;
+        state >>= 7;
     }
+    resultReg[IF1] = resultReg[IF2] = -1;
+    resultInfo[IF1] = resultInfo[IF2] = 0;
+}
+
+void Stats::getCounters(StatsCounters &c) const {
+    c.cycles = cycles;
+    c.bubbles = bubbles;
+    c.flushes = flushes;
+    c.memops = memops;
+    c.branches = branches;
+    c.taken = taken;
+    for (int i = 0; i < STALL_CAUSES; i++)
+        c.stalls[i] = stalls[i];
+}
+
+void Stats::addCounters(const StatsCounters &delta) {
+    cycles += delta.cycles;
+    bubbles += delta.bubbles;
+    flushes += delta.flushes;
+    memops += delta.memops;
+    branches += delta.branches;
+    taken += delta.taken;
+    for (int i = 0; i < STALL_CAUSES; i++)
+        stalls[i] += delta.stalls[i];
 }
 
-void Stats::bubble() {
+void Stats::bubble(STALL cause) {
     bubbles++;
     cycles++;
+    stalls[cause]++;
 
-    for (int i = WB; i > EXE1; i--) {
-        resultReg[i] = resultReg[i - 1];
-    }
-    resultReg[EXE1] = -1;
+    advance(EXE1);
+}
+
+void Stats::getSummary(RunSummary &s, long long instructions) {
+  s.instructions = instructions;
+  s.cycles = cycles;
+  s.cpi = (float)cycles / instructions;
+  s.bubbles = bubbles;
+  s.flushes = flushes;
+  s.memops = memops;
+  s.branches = branches;
+  s.taken = taken;
+}
+
+void printRunSummary(const RunSummary &s, ostream &out) {
+  out << "Cycles: " << (long long)llround(s.cycles) << endl;
+  out << "CPI: " << fixed << setprecision(2) << s.cpi << s.cpiNote << endl;
+  out << "Bubbles: " << (long long)llround(s.bubbles) << endl;
+  out << "Flushes: " << (long long)llround(s.flushes) << endl;
+  out << "Mem ops: " << setprecision(1) << 100.0 * s.memops / s.instructions << "% of instructions" << endl;
+  out << "Branches: " << 100.0 * s.branches / s.instructions << "% of instructions" << endl;
+  out << "  % Taken: " << 100.0 * s.taken / s.branches << endl;
+}
+
+double errorPct(double est, double actual) {
+  return actual == 0.0 ? 0.0 : 100.0 * (est - actual) / actual;
+}
+
+void printEstimateError(double cycles, double bubbles, double flushes, Stats &full, ostream &out) {
+  out << "Error vs full simulation: cycles " << showpos << fixed << setprecision(2)
+      << errorPct(cycles, full.getCycles()) << "%, bubbles "
+      << errorPct(bubbles, full.getBubbles()) << "%, flushes "
+      << errorPct(flushes, full.getFlushes()) << "%" << noshowpos << endl;
+}
+
+void Stats::printFUStats(ostream &out) {
+  static const char *names[ALU_OPS] = { "ADD", "AND", "SHF_L", "SHF_R", "CMP_LT", "MUL", "DIV" };
+
+  if(!fuActive) return;
+
+  out << "Functional unit stalls:" << endl;
+  for(int i = 0; i < ALU_OPS; i++) {
+    if(fu.latency[i] == 1) continue;
+    out << "  " << setw(6) << left << names[i] << right << " latency " << fu.latency[i]
+        << (fu.pipelined[i] ? ", pipelined  " : ", unpipelined") << ": "
+        << fuDataStalls[i] << " result, " << fuBusyStalls[i] << " busy" << endl;
+  }
+}
+
+// Base CPI of 1 plus the cycles per instruction lost to each cause.
+// Pipeline fill is the fixed startup cost.  There is no cache model yet,
+// so the cache miss row stays zero.
+void Stats::printCPIStack(long long instructions, ostream &out) {
+  static const char *names[STALL_CAUSES] = { "RAW on load", "RAW on ALU", "HI/LO dependence",
+                                              "branch flush", "jump flush", "jr flush",
+                                              "cache miss", "structural" };
+  double n = instructions;
+
+  out << "CPI stack:" << endl;
+  out << fixed << setprecision(3);
+  out << "  " << setw(18) << left << "base" << right << setw(8) << 1.0 << setw(14) << instructions << endl;
+  for(int i = 0; i < STALL_CAUSES; i++)
+    out << "  " << setw(18) << left << names[i] << right << setw(8) << stalls[i] / n
+        << setw(14) << stalls[i] << endl;
+  out << "  " << setw(18) << left << "pipeline fill" << right << setw(8) << (PIPESTAGES - 1) / n
+      << setw(14) << PIPESTAGES - 1 << endl;
+  out << "  " << setw(18) << left << "total" << right << setw(8) << cycles / n
+      << setw(14) << cycles << endl;
 }
 
 void Stats::showPipe() {
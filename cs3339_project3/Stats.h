@@ -0,0 +1,145 @@
+/******************************
+ * Copyright 2022, Lee B. Hinkle, all rights reserved
+ * Based on prior work by Martin Burtscher and Molly O'Neil
+ * Redistribution in source or binary form, with or without modification,
+ * is *not* permitted. Use in source or binary form, with or without
+ * modification, is only permitted for academic use in CS 3339 at
+ * Texas State University.
+ ******************************/
+#ifndef __STATS_H
+#define __STATS_H
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include "ALU.h"
+#include "Trace.h"
+#include "Profile.h"
+#include "Debug.h"
+using namespace std;
+
+enum PIPESTAGE { IF1 = 0, IF2 = 1, ID = 2, EXE1 = 3, EXE2 = 4, MEM1 = 5, 
+                 MEM2 = 6, WB = 7, PIPESTAGES = 8 };
+
+// Causes every cycle above one per instruction is charged to
+enum STALL { STALL_RAW_LOAD, STALL_RAW_ALU, STALL_HILO, STALL_BRANCH, STALL_JUMP, STALL_JR,
+             STALL_CACHE, STALL_STRUCT, STALL_CAUSES };
+
+// Execution unit timing per ALU op.  A latency above 1 delays readers of
+// the result (e.g. mfhi/mflo after mult/div) past the normal WB point; an
+// unpipelined unit also blocks the next op of its kind until it is free.
+struct FUConfig {
+  int latency[ALU_OPS];
+  bool pipelined[ALU_OPS];
+
+  FUConfig() {
+    for(int i = 0; i < ALU_OPS; i++) {
+      latency[i] = 1;
+      pipelined[i] = true;
+    }
+  }
+};
+
+// Parses one --fu spec, OP:LAT[:np] with OP one of add/and/shl/shr/slt/mul/div
+bool parseFUSpec(const char *arg, FUConfig &fu);
+
+// Cumulative counters of a Stats model; also used as deltas
+struct StatsCounters {
+  long long cycles, bubbles, flushes, memops, branches, taken;
+  long long stalls[STALL_CAUSES];
+};
+
+class Stats;
+
+// The report lines after "Program finished": counted by a full run, or
+// estimated by the sampling models
+struct RunSummary {
+  long long instructions;
+  double cycles, cpi, bubbles, flushes;
+  long long memops, branches, taken;
+  string cpiNote;     // printed after the CPI, e.g. a confidence interval
+
+  RunSummary() : instructions(0), cycles(0.0), cpi(0.0), bubbles(0.0), flushes(0.0),
+                 memops(0), branches(0), taken(0) {}
+};
+
+void printRunSummary(const RunSummary &s, ostream &out = cout);
+
+// Relative error of an estimate in percent, and the line comparing an
+// estimate's counters to those of a full run
+double errorPct(double est, double actual);
+void printEstimateError(double cycles, double bubbles, double flushes, Stats &full, ostream &out = cout);
+
+class Stats : public TraceSink {
+  private:
+    long long cycles;
+    long long flushes;
+    long long bubbles;
+
+    long long memops;
+    long long branches;
+    long long taken;
+
+    int resultReg[PIPESTAGES];
+    int resultInfo[PIPESTAGES];   // producer's text index << 1 | is-a-load
+    long long stalls[STALL_CAUSES];
+
+    FUConfig fu;
+    bool fuActive;                // any unit slower than a single cycle
+    long long fuReady[33];        // cycle a reader of the register may leave ID
+    int fuSource[33];             // op that produces it
+    int fuProducer[33];           // and the producer's text index
+    long long unitFree[ALU_OPS];  // cycle the next op of this kind may leave ID
+    long long fuDataStalls[ALU_OPS], fuBusyStalls[ALU_OPS];
+
+    PCProfile *profile;           // optional per-PC attribution
+    int curIndex;                 // text index of the instruction in ID
+
+  public:
+    Stats();
+
+    void clock();
+
+    void flush(int count, STALL cause = STALL_BRANCH);
+
+    void registerSrc(int r);
+    void registerDest(int r, bool isLoad = false);
+    void registerUnit(int op, int dest);
+
+    void setFU(const FUConfig &cfg);
+    void setProfile(PCProfile *p) { profile = p; }
+
+    void countMemOp() { memops++; }
+    void countBranch() { branches++; }
+    void countTaken() { taken++; }
+
+    void process(const InstRecord &rec);
+    void consume(const InstRecord &rec) { process(rec); }
+	
+    void showPipe();
+    void printFUStats(ostream &out = cout);
+    void printCPIStack(long long instructions, ostream &out = cout);
+
+    // getters
+    long long getCycles() { return cycles; }
+    long long getFlushes() { return flushes; }
+    long long getBubbles() { return bubbles; }
+    long long getMemOps() { return memops; }
+    long long getBranches() { return branches; }
+    long long getTaken() { return taken; }
+    long long getStalls(STALL cause) { return stalls[cause]; }
+
+    // whole-model state for timing memoization
+    bool isMemoizable() const { return !fuActive && !profile; }
+    uint64_t getPipeState() const;
+    void setPipeState(uint64_t state);
+    void getCounters(StatsCounters &c) const;
+    void getSummary(RunSummary &s, long long instructions);
+    void addCounters(const StatsCounters &delta);
+
+  private:
+    void bubble(STALL cause);
+    void advance(int from);
+};
+
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Superscalar in-order timing model.  Cycle numbers count the cycle in
+ * which an instruction leaves ID, starting from 0 for the first one.
+ */
+
+#include "Superscalar.h"
+
+SuperscalarModel::SuperscalarModel(const SuperscalarConfig &cfg) : cfg(cfg), filled(cfg.width + 1, 0) {
+  for(int i = 0; i < 33; i++)
+    regReady[i] = 0;
+  for(int i = 0; i < BREAKS; i++)
+    breaks[i] = 0;
+  redirect = 0;
+  cycle = 0;
+  count = mems = brs = 0;
+  n = 0;
+}
+
+void SuperscalarModel::closeGroup(long long next, BREAK why) {
+  filled[count]++;
+  filled[0] += next - cycle - 1;   // empty cycles spent waiting
+  breaks[why]++;
+  cycle = next;
+  count = mems = brs = 0;
+}
+
+void SuperscalarModel::consume(const InstRecord &rec) {
+  bool isMem = rec.flags & (REC_LOAD | REC_STORE);
+  bool isBr = rec.flags & (REC_BRANCH | REC_JUMP | REC_JR);
+
+  long long ready = 0;
+  for(int s = 0; s < 2; s++)
+    if(rec.src[s] > 0 && regReady[rec.src[s]] > ready)
+      ready = regReady[rec.src[s]];
+
+  if(count > 0) {
+    // reasons this instruction can't join the current group, in priority order
+    BREAK why = BREAKS;
+    if(redirect > cycle) why = BRK_FLUSH;
+    else if(ready > cycle) why = BRK_RAW;
+    else if(count == cfg.width) why = BRK_WIDTH;
+    else if(isMem && mems == cfg.memPorts) why = BRK_MEM;
+    else if(isBr && brs == cfg.branches) why = BRK_BRANCH;
+    else if(rec.dest > 0)
+      for(int i = 0; i < count; i++)
+        if(dests[i] == rec.dest) why = BRK_WAW;
+    if(why != BREAKS)
+      closeGroup(max(max(cycle + 1, ready), redirect), why);
+  }
+  else if(max(ready, redirect) > cycle) {
+    filled[0] += max(ready, redirect) - cycle;
+    cycle = max(ready, redirect);
+  }
+
+  dests[count] = rec.dest;
+  count++;
+  if(isMem) mems++;
+  if(isBr) brs++;
+
+  if(rec.dest >= 0)
+    regReady[rec.dest] = cycle + (WB - ID);
+  if(rec.flags & (REC_TAKEN | REC_JUMP | REC_JR))
+    redirect = cycle + 3;   // two flushed fetch slots
+  n++;
+}
+
+void SuperscalarModel::printFinalStats() {
+  static const char *why[BREAKS] = { "full", "RAW dependence", "memory port", "branch limit",
+                                     "WAW in group", "flush" };
+  long long cycles = cycle + PIPESTAGES, groups = 0, issueCycles = cycle + 1;
+
+  cout << "Superscalar in-order model: width " << cfg.width << ", " << cfg.memPorts
+       << " mem ports, " << cfg.branches << " branches per cycle" << endl;
+  cout << "  Cycles: " << cycles << endl;
+  cout << "  CPI: " << fixed << setprecision(2) << (double)cycles / n << endl;
+  cout << "  Issue slots filled per cycle:" << endl;
+  for(int i = 0; i <= cfg.width; i++) {
+    long long c = filled[i] + (i == count ? 1 : 0);   // the open group
+    cout << "    " << i << ": " << setw(12) << c << "  (" << setprecision(1)
+         << 100.0 * c / issueCycles << "%)" << endl;
+  }
+  for(int i = 0; i < BREAKS; i++)
+    groups += breaks[i];
+  cout << "  Groups closed by:" << endl;
+  for(int i = 0; i < BREAKS; i++)
+    cout << "    " << setw(15) << left << why[i] << right << setw(12) << breaks[i] << "  ("
+         << 100.0 * breaks[i] / (groups ? groups : 1) << "%)" << endl;
+}
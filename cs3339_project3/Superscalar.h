@@ -0,0 +1,54 @@
+#ifndef __SUPERSCALAR_H
+#define __SUPERSCALAR_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <vector>
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+struct SuperscalarConfig {
+  int width;       // instructions leaving ID per cycle
+  int memPorts;    // loads/stores per cycle
+  int branches;    // branches/jumps per cycle
+
+  SuperscalarConfig() : width(2), memPorts(1), branches(1) {}
+};
+
+// In-order N-wide version of the 8-stage Stats pipeline.  Each instruction
+// leaves ID in the same cycle as its predecessor when there is room in the
+// group and no dependence or structural conflict, otherwise in a later
+// cycle.  Hazard timing follows Stats (no forwarding: a source is ready
+// once its producer reaches WB; taken branches and jumps flush 2), so with
+// width 1 the cycle count matches Stats exactly.
+class SuperscalarModel : public TraceSink {
+  public:
+    enum BREAK { BRK_WIDTH, BRK_RAW, BRK_MEM, BRK_BRANCH, BRK_WAW, BRK_FLUSH, BREAKS };
+
+    SuperscalarModel(const SuperscalarConfig &cfg);
+
+    void consume(const InstRecord &rec);
+    void printFinalStats();
+
+    long long getCycles() const { return cycle + PIPESTAGES; }
+
+  private:
+    SuperscalarConfig cfg;
+
+    long long regReady[33];   // first cycle a reader may leave ID
+    long long redirect;       // first cycle after a flush
+    long long cycle;          // cycle of the group being filled
+    int count, mems, brs;     // group occupancy
+    int dests[64];            // registers written by the group
+    long long n;
+
+    vector<long long> filled; // cycles by number of instructions issued
+    long long breaks[BREAKS]; // why a group was closed
+
+    void closeGroup(long long next, BREAK why);
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Design sweep: fan one instruction stream out to timing workers.
+ */
+
+#include <chrono>
+#include <fstream>
+#include "Sweep.h"
+#include "CPU.h"
+#include "Memory.h"
+
+Sweep::Sweep(const Program &prog, const vector<PipeConfig> &cfgs, const SweepConfig &cfg)
+    : prog(prog), cfgs(cfgs), cfg(cfg) {
+  // contiguous shares of whole LANES-wide groups, as even as possible, so
+  // no worker pays for a partly empty group another one could have filled
+  size_t groups = (cfgs.size() + MultiTiming::LANES - 1) / MultiTiming::LANES;
+  int workers = min((size_t)cfg.threads, groups);
+  for(int w = 0; w < workers; w++) {
+    size_t b = min(cfgs.size(), groups * w / workers * MultiTiming::LANES);
+    size_t e = min(cfgs.size(), groups * (w + 1) / workers * MultiTiming::LANES);
+    firstCfg.push_back(b);
+    models.push_back(new MultiTiming(vector<PipeConfig>(cfgs.begin() + b, cfgs.begin() + e)));
+  }
+  firstCfg.push_back(cfgs.size());
+
+  for(int s = 0; s < SLOTS; s++) {
+    slots[s].recs.reserve(BATCH);
+    slots[s].pending = 0;
+  }
+  cur = &slots[0];
+  published = waits = 0;
+  done = false;
+}
+
+FAULT Sweep::run(istream &in, ostream &out) {
+  Memory instMem(prog.instMemBytes(), TEXT_BASE, false);
+  Memory dataMem(MEMSIZE, DATA_BASE, true);
+  CPU cpu(prog.start, instMem, dataMem);
+  vector<thread> workers;
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for(size_t w = 0; w < models.size(); w++)
+    workers.push_back(thread(&Sweep::work, this, (int)w));
+
+  prog.initInstMem(instMem);
+  cpu.setIO(in, out);
+  cpu.setTraceSink(this);
+  FAULT fault = cpu.run();
+
+  if(!cur->recs.empty()) publish();
+  {
+    lock_guard<mutex> g(lock);
+    done = true;
+  }
+  filled.notify_all();
+  for(size_t w = 0; w < workers.size(); w++)
+    workers[w].join();
+  chrono::duration<double> host = chrono::steady_clock::now() - t0;
+
+  if(fault == FAULT_NONE)
+    report(cpu.getInstructions(), host.count());
+  for(size_t w = 0; w < models.size(); w++)
+    delete models[w];
+  return fault;
+}
+
+void Sweep::consume(const InstRecord &rec) {
+  cur->recs.push_back(rec);
+  if(cur->recs.size() == BATCH) publish();
+}
+
+// hands the current batch to all workers and waits for the next slot
+void Sweep::publish() {
+  unique_lock<mutex> g(lock);
+  cur->pending = models.size();
+  published++;
+  filled.notify_all();
+
+  cur = &slots[published % SLOTS];
+  if(cur->pending) {
+    waits++;
+    freed.wait(g, [this] { return cur->pending == 0; });
+  }
+  cur->recs.clear();
+}
+
+void Sweep::work(int w) {
+  MultiTiming &model = *models[w];
+
+  for(long long seq = 0; ; seq++) {
+    Slot &s = slots[seq % SLOTS];
+    {
+      unique_lock<mutex> g(lock);
+      filled.wait(g, [this, seq] { return published > seq || done; });
+      if(published <= seq) return;
+    }
+    // the slot is not written again until every worker has released it
+    for(size_t i = 0; i < s.recs.size(); i++)
+      model.consume(s.recs[i]);
+    {
+      lock_guard<mutex> g(lock);
+      if(--s.pending == 0) freed.notify_one();
+    }
+  }
+}
+
+void Sweep::report(long long instructions, double host) {
+  static const char *preds[] = { "not-taken", "bimodal", "perfect" };
+  ofstream csv;
+  bool toFile = cfg.csvFile != NULL;
+
+  if(toFile) {
+    csv.open(cfg.csvFile);
+    if(!csv) cerr << "Could not open " << cfg.csvFile << ", printing rows instead" << endl;
+    toFile = csv.is_open();
+  }
+
+  cout << endl << "Sweep: " << cfgs.size() << " configurations on " << models.size()
+       << " worker thread" << (models.size() > 1 ? "s" : "") << ", " << instructions << " instructions, "
+       << fixed << setprecision(2) << host << " s host time" << endl;
+  cout << "  " << published << " batches of up to " << BATCH << " records, CPU waited for a free slot "
+       << waits << " times" << endl;
+
+  ostream &rows = toFile ? (ostream &)csv : cout;
+  rows << "name,depth,alu,load,branch,jump,jr,predictor,cycles,cpi,bubbles,flushes" << endl;
+  for(size_t w = 0; w < models.size(); w++) {
+    for(size_t i = firstCfg[w]; i < firstCfg[w + 1]; i++) {
+      const PipeConfig &c = cfgs[i];
+      int j = i - firstCfg[w];
+      long long cycles = models[w]->getCycles(j);
+      rows << c.name << "," << c.depth << "," << c.aluDist << "," << c.loadDist << ","
+           << c.branchPenalty << "," << c.jumpPenalty << "," << c.jrPenalty << "," << preds[c.predictor] << ","
+           << cycles << "," << fixed << setprecision(4) << (instructions ? (double)cycles / instructions : 0.0) << ","
+           << models[w]->getBubbles(j) << "," << models[w]->getFlushes(j) << endl;
+    }
+  }
+  if(toFile) cout << "  rows written to " << cfg.csvFile << endl;
+}
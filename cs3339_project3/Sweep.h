@@ -0,0 +1,66 @@
+#ifndef __SWEEP_H
+#define __SWEEP_H
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Program.h"
+#include "Trace.h"
+#include "PipeConfig.h"
+#include "MultiTiming.h"
+#include "Debug.h"
+using namespace std;
+
+struct SweepConfig {
+  int threads;          // timing worker threads
+  const char *csvFile;  // rows go here instead of a table on cout
+
+  SweepConfig() : threads(thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1),
+                  csvFile(NULL) {}
+};
+
+// Design sweep: one functional run broadcast to many timing models.  The
+// configurations are split over worker threads, each timing its share
+// with a MultiTiming.  Records are collected into batches that every
+// worker reads in place; a batch slot is only refilled once all workers
+// are done with it, so with SLOTS slots a slow worker holds the CPU back
+// instead of letting buffered trace grow.
+class Sweep : public TraceSink {
+  public:
+    static const size_t BATCH = 1 << 16;
+    static const int SLOTS = 8;
+
+    Sweep(const Program &prog, const vector<PipeConfig> &cfgs, const SweepConfig &cfg);
+
+    FAULT run(istream &in, ostream &out);   // guest fault, if one stopped the run
+    void consume(const InstRecord &rec);
+
+  private:
+    struct Slot {
+      vector<InstRecord> recs;
+      int pending;        // workers still reading this batch
+    };
+
+    const Program &prog;
+    vector<PipeConfig> cfgs;
+    SweepConfig cfg;
+
+    vector<MultiTiming *> models;   // one per worker
+    vector<size_t> firstCfg;        // first configuration of each worker
+    Slot slots[SLOTS];
+    Slot *cur;
+    long long published;            // batches handed to the workers
+    long long waits;                // times the CPU had to wait for a slot
+    bool done;
+    mutex lock;
+    condition_variable filled, freed;
+
+    void publish();
+    void work(int w);
+    void report(long long instructions, double host);
+};
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Interval time-series statistics with a buffered background writer.
+ */
+
+#include <cstring>
+#include "TimeSeries.h"
+
+TimeSeries::TimeSeries(Stats &model, long long interval) : model(model), interval(interval) {
+  n = 0;
+  memset(&last, 0, sizeof(last));
+  last.cycles = model.getCycles();
+  binary = false;
+  done = false;
+}
+
+TimeSeries::~TimeSeries() {
+  finish();
+}
+
+bool TimeSeries::open(const char *fileName) {
+  size_t len = strlen(fileName);
+  binary = len > 4 && !strcmp(fileName + len - 4, ".bin");
+  out.open(fileName, binary ? ios::out | ios::binary : ios::out);
+  if(!out) {
+    cerr << "error: could not write time series " << fileName << endl;
+    return false;
+  }
+  if(!binary)
+    out << "instructions,cycles,bubbles,flushes,memops,branches,taken" << endl;
+  writer = thread(&TimeSeries::writeLoop, this);
+  return true;
+}
+
+void TimeSeries::consume(const InstRecord &) {
+  if(++n % interval == 0)
+    snapshot();
+}
+
+void TimeSeries::snapshot() {
+  IntervalRow now;
+  now.instructions = n;
+  now.cycles = model.getCycles();
+  now.bubbles = model.getBubbles();
+  now.flushes = model.getFlushes();
+  now.memops = model.getMemOps();
+  now.branches = model.getBranches();
+  now.taken = model.getTaken();
+
+  IntervalRow row;
+  row.instructions = now.instructions - last.instructions;
+  row.cycles = now.cycles - last.cycles;
+  row.bubbles = now.bubbles - last.bubbles;
+  row.flushes = now.flushes - last.flushes;
+  row.memops = now.memops - last.memops;
+  row.branches = now.branches - last.branches;
+  row.taken = now.taken - last.taken;
+  last = now;
+
+  batch.push_back(row);
+  if(batch.size() == BATCH)
+    submit();
+}
+
+void TimeSeries::submit() {
+  if(batch.empty()) return;
+  {
+    lock_guard<mutex> guard(lock);
+    pending.push_back(batch);
+  }
+  ready.notify_one();
+  batch.clear();
+}
+
+void TimeSeries::finish() {
+  if(!writer.joinable()) return;
+  if(n > last.instructions)
+    snapshot();
+  submit();
+  {
+    lock_guard<mutex> guard(lock);
+    done = true;
+  }
+  ready.notify_one();
+  writer.join();
+  out.close();
+}
+
+void TimeSeries::writeLoop() {
+  for(;;) {
+    vector<IntervalRow> rows;
+    {
+      unique_lock<mutex> guard(lock);
+      ready.wait(guard, [this] { return done || !pending.empty(); });
+      if(pending.empty()) return;
+      rows.swap(pending.front());
+      pending.pop_front();
+    }
+    if(binary)
+      out.write((const char *)rows.data(), rows.size() * sizeof(IntervalRow));
+    else
+      for(size_t i = 0; i < rows.size(); i++)
+        out << rows[i].instructions << "," << rows[i].cycles << "," << rows[i].bubbles << ","
+            << rows[i].flushes << "," << rows[i].memops << "," << rows[i].branches << ","
+            << rows[i].taken << "\n";
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef __TIMESERIES_H
+#define __TIMESERIES_H
+
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Trace.h"
+#include "Stats.h"
+#include "Debug.h"
+using namespace std;
+
+// One window of the time series; all counts are deltas over the window.
+struct IntervalRow {
+  int64_t instructions, cycles, bubbles, flushes, memops, branches, taken;
+};
+
+// Snapshots a Stats model every interval instructions.  Rows are batched
+// and handed to a background thread that formats and writes them, so the
+// simulation only pays for a counter diff per window.  Files ending in
+// ".bin" get raw little-endian IntervalRow records, anything else CSV.
+class TimeSeries : public TraceSink {
+  public:
+    TimeSeries(Stats &model, long long interval);
+    ~TimeSeries();
+
+    bool open(const char *fileName);
+    void consume(const InstRecord &rec);
+    void finish();   // emit the final partial window and wait for the writer
+
+  private:
+    static const size_t BATCH = 256;
+
+    Stats &model;
+    long long interval, n;
+    IntervalRow last;          // cumulative counters at the previous snapshot
+    vector<IntervalRow> batch;
+
+    ofstream out;
+    bool binary;
+    thread writer;
+    mutex lock;
+    condition_variable ready;
+    deque<vector<IntervalRow> > pending;
+    bool done;
+
+    void snapshot();
+    void submit();
+    void writeLoop();
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <cstdint>
+#include <vector>
+#include "RingBuffer.h"
+#include "Debug.h"
+using namespace std;
+
+// Instruction class flags carried in InstRecord::flags
+enum REC_FLAG { REC_LOAD = 0x01, REC_STORE = 0x02, REC_BRANCH = 0x04, REC_TAKEN = 0x08,
+                REC_JUMP = 0x10, REC_JR = 0x20 };
+
+// Compact per-instruction record emitted by the functional CPU and
+// consumed by the timing model.  Register numbers use the same encoding
+// as Stats (0-31 GPRs, 32 = hi/lo, -1 = unused).
+struct InstRecord {
+  uint32_t pc;
+  uint32_t memAddr;   // effective address of a load/store
+  int8_t src[2];      // registers read
+  int8_t dest;        // register written
+  uint8_t flags;
+  uint8_t aluOp;      // ALU_OP used by the instruction, ALU_OPS if none
+
+  void clear(uint32_t p) {
+    pc = p;
+    memAddr = 0;
+    src[0] = src[1] = -1;
+    dest = -1;
+    flags = 0;
+    aluOp = 0;
+  }
+  void addSrc(int r) {
+    if(src[0] < 0) src[0] = r;
+    else src[1] = r;
+  }
+  void setDest(int r) { dest = r; }
+};
+
+// Anything that wants to see the instruction stream
+class TraceSink {
+  public:
+    virtual ~TraceSink() {}
+    virtual void consume(const InstRecord &rec) = 0;
+};
+
+// Forwards every record to each attached sink in order
+class TraceFanout : public TraceSink {
+  private:
+    vector<TraceSink *> sinks;
+
+  public:
+    void add(TraceSink *s) { sinks.push_back(s); }
+    bool empty() const { return sinks.empty(); }
+    void consume(const InstRecord &rec) {
+      for(size_t i = 0; i < sinks.size(); i++)
+        sinks[i]->consume(rec);
+    }
+};
+
+typedef RingBuffer<InstRecord> TraceRing;
+
+// Hands records to a timing thread through a TraceRing
+class RingSink : public TraceSink {
+  private:
+    TraceRing &ring;
+
+  public:
+    RingSink(TraceRing &ring) : ring(ring) {}
+    void consume(const InstRecord &rec) { ring.push(rec); }
+};
+
+#endif
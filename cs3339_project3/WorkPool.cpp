@@ -0,0 +1,51 @@
+/*
+ * Work-stealing pool used by the batch runner.
+ */
+
+#include "WorkPool.h"
+
+WorkPool::WorkPool(int workers) : queues(workers), nextQueue(0), steals(0) {}
+
+void WorkPool::add(const Task &t) {
+  queues[nextQueue].tasks.push_back(t);
+  nextQueue = (nextQueue + 1) % queues.size();
+}
+
+// no tasks are added once run() starts, so finding every deque empty
+// means this worker is done
+bool WorkPool::take(int w, Task &t) {
+  {
+    lock_guard<mutex> g(queues[w].lock);
+    if(!queues[w].tasks.empty()) {
+      t = queues[w].tasks.back();
+      queues[w].tasks.pop_back();
+      return true;
+    }
+  }
+  for(size_t i = 1; i < queues.size(); i++) {
+    Queue &victim = queues[(w + i) % queues.size()];
+    lock_guard<mutex> g(victim.lock);
+    if(!victim.tasks.empty()) {
+      t = victim.tasks.front();
+      victim.tasks.pop_front();
+      steals++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkPool::work(int w) {
+  Task t;
+  while(take(w, t))
+    t();
+}
+
+void WorkPool::run() {
+  vector<thread> workers;
+  for(size_t w = 1; w < queues.size(); w++)
+    workers.push_back(thread(&WorkPool::work, this, (int)w));
+  work(0);
+  for(size_t w = 0; w < workers.size(); w++)
+    workers[w].join();
+}
@@ -0,0 +1,44 @@
+#ifndef __WORKPOOL_H
+#define __WORKPOOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "Debug.h"
+using namespace std;
+
+// Work-stealing thread pool for a fixed set of independent tasks.  Tasks
+// are dealt round-robin onto one deque per worker.  A worker takes from
+// the back of its own deque and, once that is empty, steals from the
+// front of the others, so a worker stuck on one huge task does not hold
+// up the short ones queued behind it.  Each deque has its own lock; the
+// tasks here run for milliseconds to seconds, so contention is nil.
+class WorkPool {
+  public:
+    typedef function<void()> Task;
+
+    WorkPool(int workers);
+
+    void add(const Task &t);
+    void run();   // runs every task, returns when all are done
+
+    long long getSteals() const { return steals; }
+
+  private:
+    struct Queue {
+      mutex lock;
+      deque<Task> tasks;
+    };
+
+    vector<Queue> queues;
+    size_t nextQueue;
+    atomic<long long> steals;
+
+    bool take(int w, Task &t);
+    void work(int w);
+};
+
+#endif